@@ -0,0 +1,91 @@
+#ifndef ACTIVATION_HPP
+#define ACTIVATION_HPP
+
+#include "Includes.hpp"
+
+#include "General.hpp"
+
+namespace Activation {
+   /*
+    * The activation functions of the hidden nodes, as policies
+    * for the layer loops of the network. Each policy gives the
+    * function f of the value x of a node, and its derivative in
+    * terms of the outcome y = f(x), which the forward propagation
+    * already computed, so the backward propagation does not need
+    * to evaluate f again.
+    * limit is the |x| beyond which f is flat, so nodes past it
+    * learn nothing (ReLU is only flat on one side, which is not
+    * counted as saturation).
+    * The inputs of the network and its output always go through
+    * the sigmoid, as the tests expect outcomes between 0 and 1.
+    */
+
+   enum Type : uint32_t { SIGMOID, TANH, RELU, HARDSIGMOID, AMOUNT };
+
+   struct Sigmoid {
+      static constexpr double limit = General::sigmoidLimit;
+      static double f(const double x) { return General::sigmoid(x); }
+      static double df(const double y) { return y * (1.0 - y); }
+   };
+
+   struct Tanh {
+      // tanh is 1 up to double precision from here on
+      static constexpr double limit = 20.0;
+      static double f(const double x) { return std::tanh(x); }
+      static double df(const double y) { return 1.0 - y * y; }
+   };
+
+   struct Relu {
+      static constexpr double limit = HUGE_VAL;
+      static double f(const double x) { return x > 0.0 ? x : 0.0; }
+      static double df(const double y) { return y > 0.0 ? 1.0 : 0.0; }
+   };
+
+   struct HardSigmoid {
+      // A piecewise linear sigmoid: 0.2x + 0.5, clamped to [0, 1]
+      static constexpr double limit = 2.5;
+      static double f(const double x) {
+         return std::min(std::max(0.2 * x + 0.5, 0.0), 1.0);
+      }
+      static double df(const double y) { return y > 0.0 && y < 1.0 ? 0.2 : 0.0; }
+   };
+
+   inline bool parse(const std::string& name, Type& type) {
+      if (name == "sigmoid")           { type = SIGMOID; }
+      else if (name == "tanh")         { type = TANH; }
+      else if (name == "relu")         { type = RELU; }
+      else if (name == "hard-sigmoid") { type = HARDSIGMOID; }
+      else { return false; }
+      return true;
+   }
+
+   inline std::string name(const Type type) {
+      switch (type) {
+         case TANH:        return "tanh";
+         case RELU:        return "relu";
+         case HARDSIGMOID: return "hard-sigmoid";
+         default:          return "sigmoid";
+      }
+   }
+
+   inline double limit(const Type type) {
+      switch (type) {
+         case TANH:        return Tanh::limit;
+         case RELU:        return Relu::limit;
+         case HARDSIGMOID: return HardSigmoid::limit;
+         default:          return Sigmoid::limit;
+      }
+   }
+
+   inline double f(const Type type, const double x) {
+      // For the few places outside of the layer loops
+      switch (type) {
+         case TANH:        return Tanh::f(x);
+         case RELU:        return Relu::f(x);
+         case HARDSIGMOID: return HardSigmoid::f(x);
+         default:          return Sigmoid::f(x);
+      }
+   }
+}
+
+#endif
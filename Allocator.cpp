@@ -0,0 +1,107 @@
+#include "Allocator.hpp"
+
+Allocator::Allocator(const uint64_t schemes,
+                     const size_t best,
+                     const uint64_t budget,
+                     const uint64_t maxSeeds)
+   : _states(schemes), _best(best), _budget(budget), _maxSeeds(maxSeeds) {}
+
+double Allocator::halfWidth(const State& s, const uint64_t seeds) {
+   if (s.running.count < 2) { return HUGE_VAL; }
+   return z * std::sqrt(s.running.variance() / seeds);
+}
+
+bool Allocator::ranked(const State& s) {
+   return s.running.count >= 2 && s.running.count + s.running.diverged >= minSeeds;
+}
+
+void Allocator::rank() {
+   /*
+    * Settle the schemes which are clearly on one side of the split
+    * between the best and the rest, by their intervals so far.
+    * Nothing is settled for good, a later error can unsettle it.
+    */
+   std::vector< uint64_t > order;
+   for (uint64_t i = 0; i < _states.size(); i++) {
+      State& s = _states[i];
+      s.settled = false;
+      if (ranked(s)) {
+         order.push_back(i);
+      } else if (s.seeds >= minSeeds &&
+                 s.running.count + s.running.diverged == s.seeds) {
+         // Too many of its runs diverged to rank it, it is out
+         s.settled = true;
+      }
+   }
+   std::sort(order.begin(), order.end(), [this](const uint64_t a, const uint64_t b) {
+      const double ma = _states[a].running.mean, mb = _states[b].running.mean;
+      return ma != mb ? ma < mb : a < b;
+   });
+   const size_t top = std::min(_best, order.size());
+   double highestTop = -HUGE_VAL, lowestRest = HUGE_VAL;
+   for (size_t r = 0; r < order.size(); r++) {
+      const State& s = _states[order[r]];
+      const double w = halfWidth(s, s.running.count);
+      if (r < top) {
+         highestTop = std::max(highestTop, s.running.mean + w);
+      } else {
+         lowestRest = std::min(lowestRest, s.running.mean - w);
+      }
+   }
+   for (size_t r = 0; r < order.size(); r++) {
+      State& s = _states[order[r]];
+      const double w = halfWidth(s, s.running.count);
+      s.settled = r < top ? s.running.mean + w < lowestRest :
+                            s.running.mean - w > highestTop;
+   }
+   _ranked = true;
+}
+
+bool Allocator::next(uint64_t& scheme, uint64_t& seedIndex) {
+   std::unique_lock< std::mutex > lock(_mutex);
+   while (_allocated < _budget) {
+      if (_initial < _states.size() * std::min< uint64_t >(minSeeds, _maxSeeds)) {
+         // Round robin over the schemes for the first seeds
+         scheme = _initial % _states.size();
+         _initial++;
+      } else {
+         if (!_ranked) { rank(); }
+         double widest = -1.0;
+         for (uint64_t i = 0; i < _states.size(); i++) {
+            const State& s = _states[i];
+            if (s.settled || !ranked(s) || s.seeds >= _maxSeeds) { continue; }
+            const double w = halfWidth(s, s.seeds);
+            if (w > widest) {
+               widest = w;
+               scheme = i;
+            }
+         }
+         if (widest < 0.0) {
+            // Settled, unless the jobs still running say otherwise
+            if (_running == 0) { return false; }
+            _recorded.wait(lock);
+            continue;
+         }
+      }
+      seedIndex = _states[scheme].seeds++;
+      _allocated++;
+      _running++;
+      return true;
+   }
+   return false;
+}
+
+void Allocator::record(const uint64_t scheme, const double error) {
+   std::lock_guard< std::mutex > lock(_mutex);
+   _states[scheme].running.add(error);
+   _running--;
+   _ranked = false;
+   _recorded.notify_all();
+}
+
+uint64_t Allocator::settled() {
+   std::lock_guard< std::mutex > lock(_mutex);
+   if (!_ranked) { rank(); }
+   return static_cast<uint64_t>(std::count_if(_states.begin(), _states.end(),
+                                              [](const State& s) { return s.settled; }));
+}
@@ -0,0 +1,73 @@
+#ifndef ALLOCATOR_HPP
+#define ALLOCATOR_HPP
+
+#include "Includes.hpp"
+
+#include "Statistics.hpp"
+
+class Allocator {
+   /*
+    * Hands out (scheme, seed) jobs so the seeds go to the schemes
+    * whose place in the ranking is still unclear, instead of
+    * training every scheme with every seed.
+    * Every scheme first gets minSeeds seeds. After that, the final
+    * errors give each scheme a confidence interval of its mean.
+    * The schemes are ranked by mean and split into the best amount
+    * and the rest. A scheme is settled once its interval no longer
+    * overlaps the intervals on the other side of that split: it is
+    * clearly among the best, or clearly not.
+    * The next seed goes to the unsettled scheme with the widest
+    * interval, counting the seeds it is still being trained with.
+    * Allocation stops when the budget is spent or every scheme is
+    * settled.
+    */
+public:
+
+   // Seeds every scheme gets before its interval is trusted
+   static const uint32_t minSeeds = 5;
+   // Half-width of the 95% interval in standard errors
+   static constexpr double z = 1.96;
+
+   // schemes schemes, the best amount of which are looked for, with
+   // at most budget jobs in total and maxSeeds seeds per scheme.
+   Allocator(uint64_t schemes, size_t best, uint64_t budget, uint64_t maxSeeds);
+
+   // The next job: the scheme and how many seeds it had before this
+   // one. Waits for results when every job would be premature.
+   // Returns false when allocation is over.
+   bool next(uint64_t& scheme, uint64_t& seedIndex);
+
+   // The final error of a job of the scheme, from any thread
+   void record(uint64_t scheme, double error);
+
+   uint64_t allocated() const { return _allocated; }
+   uint64_t settled();
+
+private:
+
+   struct State {
+      Statistics::Running running;
+      uint64_t seeds = 0;   // allocated, finished or not
+      bool settled = false;
+   };
+
+   // Half the width of the interval of the mean over seeds errors
+   static double halfWidth(const State& s, uint64_t seeds);
+   // Whether the scheme has enough errors to be ranked
+   static bool ranked(const State& s);
+
+   void rank();
+
+   std::vector< State > _states;
+   size_t _best;
+   uint64_t _budget;
+   uint64_t _maxSeeds;
+   uint64_t _allocated = 0;
+   uint64_t _initial = 0;  // jobs of the first minSeeds seeds handed out
+   uint64_t _running = 0;  // jobs allocated but not recorded
+   bool _ranked = true;    // no results since the last ranking
+   std::mutex _mutex;
+   std::condition_variable _recorded;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "Cache.hpp"
+
+namespace {
+   const char *header = "DLNCACHE";
+}
+
+Cache::Pending::~Pending() {
+   if (_complete) { _cache->store(_key, _results); }
+}
+
+size_t Cache::Pending::reserve(const uint64_t fileEpoch, const uint64_t epoch) {
+   std::lock_guard< std::mutex > lock(_mutex);
+   _results.push_back({fileEpoch, epoch, 0.0});
+   return _results.size() - 1;
+}
+
+void Cache::Pending::set(const size_t slot, const double error) {
+   std::lock_guard< std::mutex > lock(_mutex);
+   _results[slot].error = error;
+}
+
+bool Cache::open(const std::string& folder) {
+   _folder = folder;
+   if (!_folder.empty() && _folder.back() != '/') { _folder += "/"; }
+   __attribute__((unused)) const auto unused =
+               static_cast<uint16_t>(system(("mkdir -p " + _folder +
+                                             " 2> /dev/null").c_str()));
+   struct stat st = {};
+   if (stat(_folder.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+      fprintf(stderr, "Could not use %s as cache!\n", folder.c_str());
+      _folder.clear();
+      return false;
+   }
+   return true;
+}
+
+uint64_t Cache::hash(const std::string& text) {
+   // 64 bit FNV-1a
+   uint64_t h = 14695981039346656037ULL;
+   for (const char c : text) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 1099511628211ULL;
+   }
+   return h;
+}
+
+std::string Cache::file(const std::string& key) const {
+   char name[17];
+   snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(
+               hash(std::to_string(version) + "\n" + key)));
+   return _folder + name + ".results";
+}
+
+bool Cache::find(const std::string& key, std::vector< Result >& results) {
+   results.clear();
+   std::ifstream in(file(key));
+   std::string line;
+   bool found = in && std::getline(in, line) &&
+                line == std::string(header) + " " + std::to_string(version) &&
+                std::getline(in, line) && line == key;
+   while (found && std::getline(in, line)) {
+      Result r = {};
+      char *end = nullptr;
+      std::istringstream fields(line);
+      std::string error;
+      if (!(fields >> r.fileEpoch >> r.epoch >> error)) { found = false; break; }
+      r.error = std::strtod(error.c_str(), &end);
+      if (end == error.c_str()) { found = false; break; }
+      results.push_back(r);
+   }
+   found = found && !results.empty();
+   (found ? _hits : _misses).fetch_add(1, std::memory_order_relaxed);
+   return found;
+}
+
+void Cache::store(const std::string& key, const std::vector< Result >& results) {
+   /*
+    * Written to a temporary file first and then renamed, so other
+    * processes sharing the cache never read half an entry.
+    */
+   const std::string name = file(key);
+   const std::string tmpFile = name + "." + std::to_string(getpid()) + ".tmp";
+   FILE *of = fopen(tmpFile.c_str(), "w");
+   if (of == nullptr) { return; }
+   fprintf(of, "%s %u\n%s\n", header, version, key.c_str());
+   for (const Result& r : results) {
+      // As many digits as needed to read back the same double
+      fprintf(of, "%llu %llu %.17g\n",
+              static_cast<unsigned long long>(r.fileEpoch),
+              static_cast<unsigned long long>(r.epoch), r.error);
+   }
+   const bool written = ferror(of) == 0;
+   fclose(of);
+   if (!written || rename(tmpFile.c_str(), name.c_str()) != 0) {
+      remove(tmpFile.c_str());
+   }
+}
+
+std::string Cache::describe() const {
+   const uint64_t jobs = hits() + misses();
+   char text[128];
+   snprintf(text, sizeof(text), "%llu of %llu jobs (%.1f%%) came from the cache",
+            static_cast<unsigned long long>(hits()),
+            static_cast<unsigned long long>(jobs),
+            jobs > 0 ? 100.0 * hits() / jobs : 0.0);
+   return text;
+}
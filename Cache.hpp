@@ -0,0 +1,94 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "Includes.hpp"
+
+class Cache {
+   /*
+    * The results of earlier jobs on disk, so a sweep which overlaps
+    * an earlier one only trains the jobs which are new.
+    * A job is described by a key, a text with everything which
+    * influences its results, and stored in a file named after the
+    * FNV-1a hash of that key and the version below. The key itself
+    * is stored as well, so a collision is not mistaken for a hit.
+    * An entry holds the error of every checkpoint of the job, in
+    * the order they were tested, with the epoch of the file it was
+    * written to and the epoch it was taken at.
+    * Raise the version whenever a change to the code changes the
+    * results of training or testing, so old entries are not used.
+    */
+public:
+
+   static const uint32_t version = 4;
+
+   struct Result {
+      uint64_t fileEpoch;
+      uint64_t epoch;
+      double error;
+   };
+
+   class Pending {
+      /*
+       * The results of a job which is being run. They come in from
+       * the evaluator threads, in any order, and are written to the
+       * cache once the last owner lets go of it, if the job ran to
+       * its end.
+       */
+   public:
+      Pending(Cache *cache, std::string key)
+         : _cache(cache), _key(std::move(key)) {}
+      ~Pending();
+
+      Pending(const Pending&) = delete;
+      Pending& operator=(const Pending&) = delete;
+
+      // Make room for the next result, returns its slot
+      size_t reserve(uint64_t fileEpoch, uint64_t epoch);
+      void set(size_t slot, double error);
+      // The job ran to its end, so its results can be kept
+      void complete() { _complete = true; }
+
+   private:
+      Cache *_cache;
+      std::string _key;
+      std::vector< Result > _results;
+      std::mutex _mutex;
+      std::atomic< bool > _complete{false};
+   };
+
+   Cache() = default;
+
+   Cache(const Cache&) = delete;
+   Cache& operator=(const Cache&) = delete;
+
+   // Keep the cache in this folder, which is created if needed.
+   bool open(const std::string& folder);
+   bool enabled() const { return !_folder.empty(); }
+
+   static uint64_t hash(const std::string& text);
+
+   // The results of the job with this key. Returns false, and
+   // counts a miss, if it is not in the cache.
+   bool find(const std::string& key, std::vector< Result >& results);
+
+   // Start collecting the results of the job with this key
+   std::shared_ptr< Pending > record(const std::string& key) {
+      return std::make_shared< Pending >(this, key);
+   }
+
+   uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }
+   uint64_t misses() const { return _misses.load(std::memory_order_relaxed); }
+   // Like "12 of 16 jobs (75.0%) came from the cache"
+   std::string describe() const;
+
+private:
+
+   std::string file(const std::string& key) const;
+   void store(const std::string& key, const std::vector< Result >& results);
+
+   std::string _folder;
+   std::atomic< uint64_t > _hits{0};
+   std::atomic< uint64_t > _misses{0};
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "Catalogue.hpp"
+
+namespace {
+   struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t bits;
+      uint64_t length;
+      uint64_t count;
+      uint64_t wordsPerScheme;
+      uint64_t reserved[3];
+   };
+   static_assert(sizeof(Header) == 64, "The header should fill 64 bytes");
+
+   const char magic[8] = {'D', 'L', 'N', 'S', 'C', 'H', 'E', 'M'};
+   const uint32_t version = 1;
+
+   uint32_t bitsFor(const uint32_t largest) {
+      // The smallest power of 2 amount of bits which holds largest
+      uint32_t bits = 1;
+      while (bits < 32 && (largest >> bits) != 0) { bits *= 2; }
+      return bits;
+   }
+}
+
+Catalogue::~Catalogue() {
+   release();
+}
+
+Catalogue& Catalogue::operator=(Catalogue&& other) noexcept {
+   if (this == &other) { return *this; }
+   release();
+   _length         = other._length;
+   _count          = other._count;
+   _bits           = other._bits;
+   _mask           = other._mask;
+   _wordsPerScheme = other._wordsPerScheme;
+   // The buffer of a moved vector stays where it is
+   _owned          = std::move(other._owned);
+   _words          = other._words;
+   _mapped         = other._mapped;
+   _mappedSize     = other._mappedSize;
+   other._words    = nullptr;
+   other._mapped   = nullptr;
+   other._count    = 0;
+   return *this;
+}
+
+void Catalogue::release() {
+   if (_mapped != nullptr) { munmap(_mapped, _mappedSize); }
+   _mapped = nullptr;
+   _words = nullptr;
+   _owned.clear();
+}
+
+void Catalogue::shape(const uint64_t length,
+                      const uint64_t count,
+                      const uint32_t bits) {
+   release();
+   _length = length;
+   _count = count;
+   _bits = bits;
+   _mask = (1ULL << bits) - 1;
+   _wordsPerScheme = std::max< uint64_t >((length * bits + 63) / 64, 1);
+   _owned.assign(count * _wordsPerScheme, 0);
+   _words = _owned.data();
+}
+
+void Catalogue::set(const uint64_t scheme,
+                    const uint64_t position,
+                    const uint32_t label) {
+   const uint64_t bit = position * _bits;
+   _owned[scheme * _wordsPerScheme + bit / 64] |=
+      static_cast<uint64_t>(label) << (bit % 64);
+}
+
+Catalogue Catalogue::generate(const uint64_t length) {
+   /*
+    * Scheme number s steps to the next group at position i if bit
+    * length - 1 - i of s is set, so the first position is the most
+    * significant bit. Comparing two schemes, the first position
+    * where they differ decides both the order of their names and
+    * the order of their numbers.
+    */
+   Catalogue c;
+   if (length == 0) {
+      c.shape(0, 1, 1);
+      return c;
+   }
+   if (length > 63) {
+      throw std::length_error("Too many weights to list every scheme!");
+   }
+   const uint64_t count = 1ULL << (length - 1);
+   c.shape(length, count, bitsFor(static_cast<uint32_t>(length - 1)));
+   for (uint64_t s = 0; s < count; s++) {
+      uint32_t label = 0;
+      for (uint64_t i = 1; i < length; i++) {
+         label += (s >> (length - 1 - i)) & 1;
+         if (label != 0) { c.set(s, i, label); }
+      }
+   }
+   return c;
+}
+
+Catalogue Catalogue::build(const std::vector< Labels >& schemes) {
+   Catalogue c;
+   const uint64_t length = schemes.empty() ? 0 : schemes[0].size();
+   uint32_t largest = 0;
+   for (const Labels& scheme : schemes) {
+      assert(scheme.size() == length && "Schemes of unequal length!");
+      for (const uint32_t label : scheme) { largest = std::max(largest, label); }
+   }
+   c.shape(length, schemes.size(), bitsFor(largest));
+   for (uint64_t s = 0; s < schemes.size(); s++) {
+      for (uint64_t i = 0; i < length; i++) {
+         if (schemes[s][i] != 0) { c.set(s, i, schemes[s][i]); }
+      }
+   }
+   return c;
+}
+
+void Catalogue::labels(const uint64_t scheme, Labels& out) const {
+   out.resize(_length);
+   for (uint64_t i = 0; i < _length; i++) { out[i] = label(scheme, i); }
+}
+
+namespace {
+   void appendLabel(std::string& name, const uint32_t l) {
+      if (l <= '~' - 'A') {
+         name += static_cast<char>('A' + l);
+      } else {
+         name += "(" + std::to_string(l) + ")";
+      }
+   }
+}
+
+std::string Catalogue::name(const uint64_t scheme) const {
+   std::string n;
+   n.reserve(_length);
+   for (uint64_t i = 0; i < _length; i++) { appendLabel(n, label(scheme, i)); }
+   return n;
+}
+
+std::string Catalogue::name(const Labels& labels) {
+   std::string n;
+   n.reserve(labels.size());
+   for (const uint32_t l : labels) { appendLabel(n, l); }
+   return n;
+}
+
+bool Catalogue::save(const std::string& file) const {
+   /*
+    * Written to a temporary file first and then renamed, so
+    * another process never maps half a catalogue.
+    */
+   Header h = {};
+   std::memcpy(h.magic, magic, sizeof(magic));
+   h.version = version;
+   h.bits = _bits;
+   h.length = _length;
+   h.count = _count;
+   h.wordsPerScheme = _wordsPerScheme;
+
+   const std::string tmpFile = file + ".tmp";
+   FILE *of = fopen(tmpFile.c_str(), "wb");
+   if (of == nullptr) { return false; }
+   fwrite(&h, sizeof(h), 1, of);
+   fwrite(_words, sizeof(uint64_t), _count * _wordsPerScheme, of);
+   const bool written = ferror(of) == 0;
+   fclose(of);
+   if (!written || rename(tmpFile.c_str(), file.c_str()) != 0) {
+      remove(tmpFile.c_str());
+      return false;
+   }
+   return true;
+}
+
+bool Catalogue::map(const std::string& file) {
+   const int fd = open(file.c_str(), O_RDONLY);
+   if (fd < 0) { return false; }
+   struct stat st = {};
+   if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+      close(fd);
+      return false;
+   }
+   const auto size = static_cast<size_t>(st.st_size);
+   void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (data == MAP_FAILED) { return false; }
+
+   const auto *h = static_cast<const Header*>(data);
+   const bool valid = std::memcmp(h->magic, magic, sizeof(magic)) == 0 &&
+                      h->version == version &&
+                      h->bits >= 1 && h->bits <= 32 &&
+                      (h->bits & (h->bits - 1)) == 0 &&
+                      h->wordsPerScheme ==
+                         std::max< uint64_t >((h->length * h->bits + 63) / 64, 1) &&
+                      size == sizeof(Header) +
+                              h->count * h->wordsPerScheme * sizeof(uint64_t);
+   if (!valid) {
+      munmap(data, size);
+      return false;
+   }
+   release();
+   _length = h->length;
+   _count = h->count;
+   _bits = h->bits;
+   _mask = (1ULL << _bits) - 1;
+   _wordsPerScheme = h->wordsPerScheme;
+   _mapped = data;
+   _mappedSize = size;
+   _words = reinterpret_cast<const uint64_t*>(static_cast<const char*>(data) +
+                                              sizeof(Header));
+   return true;
+}
+
+Catalogue Catalogue::cached(const std::string& file, const uint64_t length) {
+   Catalogue c;
+   if (c.map(file) && c.length() == length) { return c; }
+   c = generate(length);
+   if (!c.save(file)) {
+      fprintf(stderr, "Could not save the scheme catalogue to %s.\n",
+              file.c_str());
+   }
+   return c;
+}
@@ -0,0 +1,85 @@
+#ifndef CATALOGUE_HPP
+#define CATALOGUE_HPP
+
+#include "Includes.hpp"
+
+class Catalogue {
+   /*
+    * All schemes of a sweep, stored once and shared by every
+    * thread. A scheme assigns every weight the integer label of
+    * its group, where weights with equal labels start with the
+    * same 'random' weight.
+    * The labels are bit packed, with the same amount of bits for
+    * every label (a power of 2, so a label never spans two words),
+    * and every scheme starts at a new 64 bit word. The words are
+    * either owned by the catalogue or mapped from a file.
+    * Once built, a catalogue never changes.
+    */
+public:
+   typedef std::vector< uint32_t > Labels;
+
+   Catalogue() = default;
+   ~Catalogue();
+   Catalogue(Catalogue&& other) noexcept { *this = std::move(other); }
+   Catalogue& operator=(Catalogue&& other) noexcept;
+   Catalogue(const Catalogue&) = delete;
+   Catalogue& operator=(const Catalogue&) = delete;
+
+   // All schemes of the given length in which every weight is in
+   // the group of the weight before it, or in the next group.
+   // These are numbered such that the order of their names is the
+   // order of their numbers. A length of 0 gives one empty scheme.
+   static Catalogue generate(uint64_t length);
+
+   // Build a catalogue of the given schemes, all of equal length
+   static Catalogue build(const std::vector< Labels >& schemes);
+
+   // Write the catalogue to file, returns false if that failed
+   bool save(const std::string& file) const;
+
+   // Map a catalogue which was saved before. Returns false, leaving
+   // the catalogue as it was, if the file is not a valid catalogue.
+   bool map(const std::string& file);
+
+   // The mapped catalogue in file if it has schemes of the given
+   // length, else the generated one, which is then saved to file.
+   static Catalogue cached(const std::string& file, uint64_t length);
+
+   uint64_t size() const { return _count; }
+   uint64_t length() const { return _length; }
+   uint32_t bits() const { return _bits; }
+   // The amount of bytes the labels take up
+   uint64_t bytes() const { return _count * _wordsPerScheme * sizeof(uint64_t); }
+
+   uint32_t label(const uint64_t scheme, const uint64_t position) const {
+      const uint64_t bit = position * _bits;
+      const uint64_t word = _words[scheme * _wordsPerScheme + bit / 64];
+      return static_cast<uint32_t>((word >> (bit % 64)) & _mask);
+   }
+
+   void labels(uint64_t scheme, Labels& out) const;
+
+   // The name of a scheme, as used in the names of the result files.
+   // Labels 0 to 61 are the letters 'A' to '~', larger labels are
+   // written as their number between brackets.
+   std::string name(uint64_t scheme) const;
+   static std::string name(const Labels& labels);
+
+private:
+   void shape(uint64_t length, uint64_t count, uint32_t bits);
+   void set(uint64_t scheme, uint64_t position, uint32_t label);
+   void release();
+
+   uint64_t _length = 0;
+   uint64_t _count = 0;
+   uint32_t _bits = 1;
+   uint64_t _mask = 1;
+   uint64_t _wordsPerScheme = 0;
+   const uint64_t *_words = nullptr;
+   std::vector< uint64_t > _owned;
+   // The mapping, when the words come from a file
+   void *_mapped = nullptr;
+   size_t _mappedSize = 0;
+};
+
+#endif
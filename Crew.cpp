@@ -0,0 +1,71 @@
+#include "Crew.hpp"
+
+Crew::~Crew() {
+   {
+      std::lock_guard< std::mutex > lock(_mutex);
+      _stop = true;
+   }
+   _start.notify_all();
+   for (std::thread& thread : _threads) { thread.join(); }
+}
+
+void Crew::run(const unsigned int amount,
+               const std::function< void(unsigned int) >& work) {
+   /*
+    * Start the threads this step needs on top of the ones there
+    * are, hand out the step and do the first part here.
+    */
+   if (amount <= 1) {
+      work(0);
+      return;
+   }
+   {
+      std::lock_guard< std::mutex > lock(_mutex);
+      while (_threads.size() + 1 < amount) {
+         const auto t = static_cast<unsigned int>(_threads.size() + 1);
+         _threads.emplace_back(&Crew::loop, this, t);
+      }
+      _work = &work;
+      _amount = amount;
+      _busy = amount - 1;
+      _error = nullptr;
+      _step++;
+   }
+   _start.notify_all();
+
+   std::exception_ptr error;
+   try {
+      work(0);
+   } catch (...) {
+      error = std::current_exception();
+   }
+
+   std::unique_lock< std::mutex > lock(_mutex);
+   _done.wait(lock, [this] { return _busy == 0; });
+   _work = nullptr;
+   if (!error) { error = _error; }
+   lock.unlock();
+   if (error) { std::rethrow_exception(error); }
+}
+
+void Crew::loop(const unsigned int t) {
+   uint64_t seen = 0;
+   std::unique_lock< std::mutex > lock(_mutex);
+   while (true) {
+      _start.wait(lock, [this, seen] { return _stop || _step != seen; });
+      if (_stop) { return; }
+      seen = _step;
+      if (t >= _amount) { continue; }
+      const std::function< void(unsigned int) >& work = *_work;
+      lock.unlock();
+      try {
+         work(t);
+      } catch (...) {
+         lock.lock();
+         if (!_error) { _error = std::current_exception(); }
+         lock.unlock();
+      }
+      lock.lock();
+      if (--_busy == 0) { _done.notify_one(); }
+   }
+}
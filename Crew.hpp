@@ -0,0 +1,51 @@
+#ifndef CREW_HPP
+#define CREW_HPP
+
+#include "Includes.hpp"
+
+class Crew {
+   /*
+    * A fixed set of threads which work on one step at a time.
+    * run() gives every thread its part of a step and waits until
+    * all parts are done. The threads are started when first
+    * needed and kept until the crew is destroyed, so a training
+    * run pays for starting them once instead of once per step.
+    * The threads inherit the floating point mode of the thread
+    * which starts them.
+    */
+public:
+
+   Crew() = default;
+   ~Crew();
+
+   Crew(const Crew&) = delete;
+   Crew& operator=(const Crew&) = delete;
+
+   // Run work(t) for every t below amount and wait for all of them.
+   // work(0) runs on the calling thread. An exception thrown by one
+   // of the parts is thrown again here.
+   void run(unsigned int amount, const std::function< void(unsigned int) >& work);
+
+   // The amount of threads started, besides the calling one
+   size_t size() const { return _threads.size(); }
+
+private:
+
+   void loop(unsigned int t);
+
+   std::vector< std::thread > _threads;
+   std::mutex _mutex;
+   std::condition_variable _start;
+   std::condition_variable _done;
+   const std::function< void(unsigned int) > *_work = nullptr;
+   // The threads below amount take part in the current step
+   unsigned int _amount = 0;
+   // Counts the steps, so a thread sees when a new one begins
+   uint64_t _step = 0;
+   // The parts of the current step which are not done yet
+   unsigned int _busy = 0;
+   bool _stop = false;
+   std::exception_ptr _error;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "Dln.hpp"
+
+#include "Tests.hpp"
+
+uint32_t Dln::inputs(const std::string& test) {
+   // + 1 is to indicate the bias node.
+   if (test == "xor") { return 2 + 1; }
+   if (test == "abc") { return 3 + 1; }
+   if (test == "gates") { return 2 + 1; }
+   return 0;
+}
+
+uint32_t Dln::outputs(const std::string& test) {
+   // gates has the xor, and and or of its inputs as targets
+   if (test == "xor" || test == "abc") { return 1; }
+   if (test == "gates") { return 3; }
+   return 0;
+}
+
+uint64_t Dln::weights(const Config& config) {
+   // The weights to bias nodes should not be considered in the scheme, as
+   // they are irrelevant as the bias node has a constant value.
+   const uint64_t hiddenNodes = config.hidden + 1;
+   const uint64_t outputNodes = outputs(config.test);
+   return (static_cast<uint64_t>(inputs(config.test)) * (hiddenNodes - 1)) +
+          (hiddenNodes * (hiddenNodes - 1) * (config.layers - 1))         +
+          (hiddenNodes * outputNodes);
+}
+
+namespace {
+   void fillSchemeWeights(const Catalogue::Labels& labels,
+                          const unsigned int seed,
+                          const unsigned int shuffleSeed,
+                          vecdo& weights,
+                          vecdo& drawn,
+                          std::vector< uint32_t >& slots) {
+      /*
+       * Function takes a scheme of labels like 0001112223 etc,
+       * where equal labels represent the same 'random'
+       * weight in that position, wherever they are.
+       * Then it makes a vector of equal length with on each
+       * position a 'random' weight, according to this scheme.
+       * Every label gets its own weight, in order of appearance.
+       * If we want to perform a different permutation of weights,
+       * this is applied by shuffling the weights. A seed of 1
+       * just reverses the vector.
+       * slots holds, per label, one more than the index of its
+       * weight in drawn, or 0 if it has none yet. All three
+       * buffers keep their memory between calls.
+       */
+      unsigned int state = seed;
+      const uint32_t labelsEnd = labels.empty() ? 0 :
+                                 *std::max_element(labels.begin(), labels.end()) + 1;
+      slots.assign(labelsEnd, 0);
+      drawn.clear();
+      weights.assign(labels.size(), -1.0);
+      for (size_t i = 0; i < labels.size(); i++) {
+         uint32_t& slot = slots[labels[i]];
+         if (slot == 0) {
+            drawn.push_back(drawn.empty() ? General::randomWeight(state) :
+                                            General::trueRandomWeight(state, drawn));
+            slot = static_cast<uint32_t>(drawn.size());
+         }
+         weights[i] = drawn[slot - 1];
+      }
+      if (shuffleSeed == 1) {
+         std::reverse(weights.begin(), weights.end());
+      }
+      if (shuffleSeed > 1) {
+         std::shuffle(weights.begin(), weights.end(),
+                      std::default_random_engine(shuffleSeed));
+      }
+   }
+}
+
+vecdo Dln::schemeWeights(const Catalogue::Labels& labels,
+                         const unsigned int seed,
+                         const unsigned int shuffleSeed) {
+   vecdo weights, drawn;
+   std::vector< uint32_t > slots;
+   fillSchemeWeights(labels, seed, shuffleSeed, weights, drawn, slots);
+   return weights;
+}
+
+void Dln::tie(vecdo& weights, const Catalogue::Labels& labels, const double pull) {
+   /*
+    * A pull of 1 gives every weight of a group the average of
+    * the group.
+    */
+    const auto schemeLength = static_cast<unsigned int>(labels.size());
+    vecdo weightSums(schemeLength, 0.0);
+    std::vector<unsigned int> letterCount(schemeLength, 0);
+    
+    for (unsigned int i = 0; i < schemeLength; i++) {
+       weightSums[labels[i]] += weights[i];
+       letterCount[labels[i]]++;
+    }
+    
+    // Take the averages of the weightSums
+    vecdo weightAverages(schemeLength, 0.0);
+    for (unsigned int j = 0; j < schemeLength; j++) {
+       weightAverages[labels[j]] = letterCount[labels[j]] > 0 ? weightSums[labels[j]] /
+       letterCount[labels[j]] : 0;
+    }
+    
+    // Then use these to nudge the weights
+    for (unsigned int k = 0; k < schemeLength; k++) {
+      weights[k] = pull == 1.0 ? weightAverages[labels[k]] :
+                   weights[k] - (weights[k] - weightAverages[labels[k]]) * pull;
+    }
+}
+
+Network Dln::build(const Config& config,
+                   const uint16_t seed,
+                   const Catalogue::Labels& labels,
+                   const std::string& scheme) {
+   /*
+    * This is basically only calling the functions
+    * which set the weights.
+    * If a scheme is used, first schemeVector is filled
+    * so that the scheme is reflected in the weights.
+    * The '+ 1' after hidden is to account for the bias
+    * node, which is added to the network.
+    */
+   const uint32_t inputNodes = inputs(config.test);
+   if (inputNodes == 0) {
+      throw std::invalid_argument("Unknown test " + config.test + "!");
+   }
+   const uint32_t hiddenNodes = config.hidden + 1;
+   const uint32_t outputNodes = outputs(config.test);
+   vecvecdo wFI(inputNodes, vecdo(hiddenNodes));
+   std::vector< vecvecdo > wHL(config.layers,
+                          vecvecdo(hiddenNodes,
+                                   vecdo(hiddenNodes)));
+   vecvecdo wTO(hiddenNodes, vecdo(outputNodes));
+   vecvecdo hiddenLayers(config.layers,
+                         vecdo(hiddenNodes));
+   for (vecdo& layer : hiddenLayers) {
+      // The value is actually never used, but it gives a better view
+      // of what's happening when the graph is drawn.
+      layer[hiddenNodes - 1] = -1.0;
+   }
+   vecdo schemeVector = {};
+   if (!labels.empty()) {
+      schemeVector = schemeWeights(labels, seed, config.shuffleSeed);
+   }
+   
+   Network n(vecdo(inputNodes),
+             wFI,
+             hiddenLayers,
+             wHL,
+             wTO,
+             0.0,
+             config.alpha,
+             0.0,
+             scheme);
+   
+   n.initialiseWeights(seed, //seed
+                       schemeVector); //scheme weights
+   n.optimizer(config.optimizer);
+   n.activation(config.activation);
+   return n;
+}
+
+Network& Dln::Pool::acquire(const uint16_t seed,
+                            const Catalogue::Labels& labels,
+                            const std::string& scheme) {
+   if (!_network) {
+      _network.reset(new Network(build(_config, seed, labels, scheme)));
+      return *_network;
+   }
+   _weights.clear();
+   if (!labels.empty()) {
+      fillSchemeWeights(labels, seed, _config.shuffleSeed, _weights, _drawn, _slots);
+   }
+   _network->reset(seed, scheme, _weights);
+   _network->alpha(_config.alpha);
+   _reused++;
+   return *_network;
+}
+
+uint64_t Dln::train(Network& n, const Config& config, const uint64_t epochs) {
+   Tests tests;
+   vecdo inputVector;
+   vecdo expectedOutputs;
+   uint64_t epoch = 0;
+   for (; epoch < epochs && !n.diverged(); epoch++) {
+      n.alpha(config.schedule.alpha(config.alpha, epoch, epochs));
+      tests.runSmallTest(inputVector, expectedOutputs, config.test);
+      n.inputs(inputVector);
+      n.expectedOutputs(expectedOutputs);
+      n.train();
+   }
+   return epoch;
+}
+
+double Dln::evaluate(const Network& n, const std::string& test) {
+   Tests tests;
+   const Tests::TestParameters param(n, false, "", "a", true, 0);
+   return tests.runTest(param, test, false);
+}
+
+bool Dln::save(const Network& n, const std::string& file) {
+   return Model::save(n, file);
+}
@@ -0,0 +1,132 @@
+#ifndef DLN_HPP
+#define DLN_HPP
+
+#include "Includes.hpp"
+
+#include "Activation.hpp"
+#include "Catalogue.hpp"
+#include "Model.hpp"
+#include "Network.hpp"
+#include "Optimizer.hpp"
+
+namespace Dln {
+   /*
+    * The interface of libdln, to build, train, test, save and use
+    * networks from another program, without the dln binary and its
+    * result files. dln itself is a client of these functions.
+    * Training draws its cases with rand(), so networks trained on
+    * different threads at the same time do not get reproducible
+    * cases. Everything else may be called from any thread, on
+    * different networks.
+    */
+
+   struct Config {
+      std::string test = "xor";
+      uint32_t layers = 1;
+      uint32_t hidden = 2;         // nodes per layer, without the bias node
+      double alpha = 0.5;          // the base learning rate
+      Activation::Type activation = Activation::SIGMOID;
+      Optimizer optimizer;
+      Schedule schedule;
+      unsigned int shuffleSeed = 0; // permutes the weights of a scheme
+   };
+
+   // The input nodes of the test, the bias node included, or 0 if
+   // there is no such test.
+   uint32_t inputs(const std::string& test);
+
+   // The output nodes of the test, one per target, or 0 if there is
+   // no such test.
+   uint32_t outputs(const std::string& test);
+
+   // The amount of weights a scheme for this configuration labels
+   uint64_t weights(const Config& config);
+
+   // A 'random' weight per label of the scheme, the same for equal
+   // labels, permuted by shuffleSeed.
+   vecdo schemeWeights(const Catalogue::Labels& labels,
+                       unsigned int seed,
+                       unsigned int shuffleSeed = 0);
+
+   // Move the first labels.size() weights the fraction pull of the
+   // way to the average of the weights with the same label.
+   void tie(vecdo& weights, const Catalogue::Labels& labels, double pull);
+
+   // A new network, with the weights of the scheme if labels are
+   // given, else random weights. Throws std::invalid_argument for
+   // an unknown test.
+   Network build(const Config& config,
+                 uint16_t seed,
+                 const Catalogue::Labels& labels = {},
+                 const std::string& scheme = "");
+
+   // Train on epochs cases of the test, stopping early if the
+   // network diverges. Returns the epochs trained.
+   uint64_t train(Network& n, const Config& config, uint64_t epochs);
+
+   // The error of the network over all cases of the test
+   double evaluate(const Network& n, const std::string& test);
+
+   // Write the network as a model file, see Model.hpp
+   bool save(const Network& n, const std::string& file);
+
+   class Pool {
+      /*
+       * The network of one configuration, for a worker which
+       * trains job after job with it. The network is built for
+       * the first job and reset in place for every next one, so
+       * the allocations do not grow with the amount of jobs.
+       */
+   public:
+      explicit Pool(const Config& config) : _config(config) {}
+
+      Pool(const Pool&) = delete;
+      Pool& operator=(const Pool&) = delete;
+
+      // A network like build() gives for these arguments. It is the
+      // same network every time, so it is only valid until the next
+      // call. Throws like build().
+      Network& acquire(uint16_t seed,
+                       const Catalogue::Labels& labels = {},
+                       const std::string& scheme = "");
+
+      // How many times acquire() reused the network
+      uint64_t reused() const { return _reused; }
+
+   private:
+      Config _config;
+      std::unique_ptr< Network > _network;
+      // Buffers for the weights of the schemes
+      vecdo _weights;
+      vecdo _drawn;
+      std::vector< uint32_t > _slots;
+      uint64_t _reused = 0;
+   };
+
+   class Predictor {
+      /*
+       * A saved model, ready for inference from any amount of
+       * threads at once.
+       */
+   public:
+      explicit Predictor(const std::string& file) : _model(file) {}
+
+      bool valid() const { return _model.valid(); }
+      const Model::Header& header() const { return _model.header(); }
+      std::string scheme() const { return _model.scheme(); }
+
+      // The output of the network for the inputs, between 0 and 1.
+      // The inputs are those of the test, without the bias node.
+      double predict(const vecdo& inputs) const {
+         thread_local vecdo withBias;
+         withBias.assign(inputs.begin(), inputs.end());
+         withBias.push_back(-1.0);
+         return General::sigmoid(_model.forward(withBias));
+      }
+
+   private:
+      Model::Mapped _model;
+   };
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "Evaluator.hpp"
+
+#include "Trace.hpp"
+
+void Evaluator::start(const uint32_t threads, const size_t capacity) {
+   stop();
+   _evaluated.store(0);
+   _stalled.store(0);
+   if (capacity == 0) { return; }
+   const uint32_t amThreads = std::max< uint32_t >(
+                                 1, std::min< uint64_t >(threads, capacity));
+   for (uint32_t t = 0; t < amThreads; t++) {
+      _queues.emplace_back(new Queue);
+      Queue& queue = *_queues.back();
+      // The capacity is divided over the threads
+      queue.capacity = std::max< size_t >(1, capacity / amThreads);
+      queue.thread = std::thread(&Evaluator::evaluate, this, std::ref(queue));
+   }
+}
+
+void Evaluator::publish(Tests::TestParameters snapshot,
+                        const std::string& test,
+                        std::string row/* = ""*/,
+                        std::function< void(double) > tested/* = nullptr*/) {
+   if (_queues.empty()) {
+      Tests tests;
+      Snapshot s = {std::move(snapshot), test, std::move(row), std::move(tested)};
+      this->test(tests, s);
+      return;
+   }
+   Queue& queue = *_queues[static_cast<size_t>(snapshot.seed) % _queues.size()];
+   std::unique_lock< std::mutex > lock(queue.mutex);
+   if (queue.snapshots.size() >= queue.capacity) {
+      const auto waiting = std::chrono::steady_clock::now();
+      queue.room.wait(lock, [&queue] {
+         return queue.snapshots.size() < queue.capacity;
+      });
+      _stalled.fetch_add(static_cast<uint64_t>(
+                            std::chrono::duration_cast< std::chrono::microseconds >(
+                               std::chrono::steady_clock::now() - waiting).count()),
+                         std::memory_order_relaxed);
+   }
+   queue.snapshots.push_back({std::move(snapshot), test, std::move(row),
+                              std::move(tested)});
+   lock.unlock();
+   queue.ready.notify_one();
+}
+
+void Evaluator::stop() {
+   for (auto& queue : _queues) {
+      {
+         std::lock_guard< std::mutex > lock(queue->mutex);
+         queue->stop = true;
+      }
+      queue->ready.notify_one();
+   }
+   for (auto& queue : _queues) { queue->thread.join(); }
+   _queues.clear();
+}
+
+void Evaluator::evaluate(Queue& queue) {
+   /*
+    * Test the snapshots in the order they were published. Only
+    * stop once the queue is empty, so no result gets lost.
+    */
+   Tests tests;
+   std::unique_lock< std::mutex > lock(queue.mutex);
+   while (true) {
+      queue.ready.wait(lock, [&queue] {
+         return queue.stop || !queue.snapshots.empty();
+      });
+      if (queue.snapshots.empty()) { return; }
+      Snapshot snapshot = std::move(queue.snapshots.front());
+      queue.snapshots.pop_front();
+      lock.unlock();
+      queue.room.notify_one();
+      test(tests, snapshot);
+      lock.lock();
+   }
+}
+
+void Evaluator::test(Tests& tests, Snapshot& snapshot) {
+   Trace::Span span("evaluate", "test", snapshot.params.seed);
+   double error;
+   if (_results != nullptr && !snapshot.row.empty()) {
+      error = tests.runTest(std::move(snapshot.params), snapshot.test, false);
+      _results->append(snapshot.row, error);
+   } else {
+      error = tests.runTest(std::move(snapshot.params), snapshot.test, _dumps);
+   }
+   if (snapshot.tested) { snapshot.tested(error); }
+   _evaluated.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+#ifndef EVALUATOR_HPP
+#define EVALUATOR_HPP
+
+#include "Includes.hpp"
+
+#include "Results.hpp"
+#include "Tests.hpp"
+
+class Evaluator {
+   /*
+    * Tests the checkpoints of the runs on threads of its own, so
+    * the workers go on training while the errors are computed and
+    * written to the result files.
+    * A worker publishes a snapshot: a copy of its network which
+    * training never touches again, so the weights need no locking.
+    * At most capacity snapshots wait at any time. A worker which
+    * publishes to a full queue waits for room, which bounds the
+    * memory the snapshots take.
+    * All snapshots of a seed go to the same thread, so the results
+    * of a run are written in the order of its epochs.
+    * Snapshots published with a row go to the results store, if
+    * one is given, instead of the result file of the test. Without
+    * dumps the others are only tested, for their callback.
+    */
+public:
+
+   Evaluator() = default;
+   ~Evaluator() { stop(); }
+
+   Evaluator(const Evaluator&) = delete;
+   Evaluator& operator=(const Evaluator&) = delete;
+
+   // Start the given amount of threads, which share a queue of
+   // capacity snapshots. With a capacity of 0 nothing is started
+   // and publish() tests on the calling thread.
+   void start(uint32_t threads, size_t capacity);
+
+   // Hand over a snapshot to be tested, the result is printed.
+   // tested is called with the error once it is known.
+   void publish(Tests::TestParameters snapshot,
+                const std::string& test,
+                std::string row = "",
+                std::function< void(double) > tested = nullptr);
+
+   void results(Results *results) { _results = results; }
+   void dumps(bool dumps) { _dumps = dumps; }
+
+   // Wait until every snapshot has been tested and stop the threads.
+   void stop();
+
+   uint64_t evaluated() const { return _evaluated.load(std::memory_order_relaxed); }
+   // Milliseconds the workers waited for room in the queue
+   double stalled() const {
+      return _stalled.load(std::memory_order_relaxed) / 1000.0;
+   }
+
+private:
+
+   struct Snapshot {
+      Tests::TestParameters params;
+      std::string test;
+      std::string row;
+      std::function< void(double) > tested;
+   };
+
+   struct Queue {
+      std::deque< Snapshot > snapshots;
+      size_t capacity = 1;
+      bool stop = false;
+      std::mutex mutex;
+      std::condition_variable ready;
+      std::condition_variable room;
+      std::thread thread;
+   };
+
+   void evaluate(Queue& queue);
+   void test(Tests& tests, Snapshot& snapshot);
+
+   std::vector< std::unique_ptr< Queue > > _queues;
+   Results *_results = nullptr;
+   bool _dumps = true;
+   std::atomic< uint64_t > _evaluated{0};
+   std::atomic< uint64_t > _stalled{0}; // in microseconds
+};
+
+#endif
@@ -1,8 +1,10 @@
-#ifndef GENERAL_CPP
-#define GENERAL_CPP
+#ifndef GENERAL_HPP
+#define GENERAL_HPP
 
 #include "Includes.hpp"
 
+#include "Trace.hpp"
+
 namespace General {
    
    template <typename T>
@@ -16,11 +18,18 @@ namespace General {
       return out.str();
    }
    
+   // Beyond this the sigmoid is 0 or 1 up to double precision, so
+   // its input is clamped to it. This keeps exp() from overflowing and
+   // the outcome from becoming denormal.
+   constexpr double sigmoidLimit = 36.0;
+   
    inline double sigmoid(const double x) {
       /*
        * Returns the y-value the default sigmoid has at coordinate x.
+       * x is clamped to [-sigmoidLimit, sigmoidLimit] first.
        */
-      return 1.0 / (1.0 + exp(-x));
+      const double clamped = std::min(std::max(x, -sigmoidLimit), sigmoidLimit);
+      return 1.0 / (1.0 + exp(-clamped));
    }
    
    inline double sigmoid_d(const double x) {
@@ -32,6 +41,18 @@ namespace General {
       return y * (1.0 - y);
    }
    
+   inline void flushDenormals() {
+      /*
+       * Make the calling thread flush denormal results to zero and
+       * treat denormal inputs as zero, instead of slowly computing
+       * with them. Threads started afterwards inherit this mode.
+       */
+#if defined(__SSE__) || defined(__x86_64__)
+      // Flush to zero (bit 15) and denormals are zero (bit 6) of MXCSR
+      _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+   }
+   
    inline vecdo flatten(vecvecdo const& toFlatten) {
       /*
        * Flattens a vector of vectors of doubles toFlatten to a 
@@ -61,39 +82,43 @@ namespace General {
       return flat;
    }
    
-   inline double randomWeight(unsigned int seed) {
-      return -1 + 2 * (static_cast<double>(rand_r(&seed)) / RAND_MAX);
+   inline double randomWeight(unsigned int& state) {
+      // The state is advanced, so every call gives the next weight
+      return -1 + 2 * (static_cast<double>(rand_r(&state)) / RAND_MAX);
    }
    
-   inline double trueRandomWeight(unsigned int seed, vecdo pastWeights) {
+   inline double trueRandomWeight(unsigned int& state, const vecdo& pastWeights) {
       /*
        * Ensure the generated weights are 'truly' different.
        * This is ensured by having all weights differ by at least 'margin'.
+       * Past about 2 / margin weights there may be no room left, so
+       * after 'attempts' draws the last one is taken as it is.
        */
       const double margin = 0.01; //change if needed
+      const unsigned int attempts = 1000;
       double randomNumber = -1.0;
-      bool stop = false;
-      while (!stop) {
-         stop = true;
-         randomNumber = randomWeight(seed);
+      for (unsigned int a = 0; a < attempts; a++) {
+         randomNumber = randomWeight(state);
+         bool stop = true;
          for (double weight : pastWeights) {
-            if (randomNumber == weight + margin || 
-                randomNumber == weight - margin) {
+            if (std::fabs(randomNumber - weight) < margin) {
                stop = false;
                break;
             }
          }
+         if (stop) { break; }
       }
-      assert(randomNumber != -1.0);
       return randomNumber;
    }
    
    inline FILE *openFile (const std::string& filename, const char *writeMode = "w") {
       FILE *of = nullptr;
       unsigned int failcount = 0;
+      uint64_t retryStart = 0;
       while (true) {
          of = fopen(filename.c_str(), writeMode);
          if (of == nullptr) {
+            if (failcount == 0 && Trace::enabled()) { retryStart = Trace::now(); }
             failcount++;
             if (failcount > 1000000) {
                fprintf(stderr, "File could not be opened within 10 seconds!\nFilename: %s\n", filename.c_str());
@@ -104,6 +129,7 @@ namespace General {
             break;
          }
       }
+      if (failcount > 0) { Trace::record("openFile retry", "io", retryStart); }
       return of;
    }
 }
@@ -2,29 +2,54 @@
 #define INCLUDES_HPP
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cfenv>
+#include <cfloat>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <csignal>
 #include <cstdio>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
 #include <ctime>
 #include <exception>
+#include <fstream>
+#include <functional>
 #include <future>
+#include <getopt.h>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <pthread.h>
+#include <queue>
 #include <random>
 #include <regex>
+#include <sched.h>
+#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
 typedef std::vector< double > vecdo;
 typedef std::vector< vecdo > vecvecdo;
 
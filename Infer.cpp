@@ -0,0 +1,156 @@
+#include "Infer.hpp"
+
+namespace {
+   struct Batch {
+      uint64_t number;
+      size_t count = 0;
+      vecdo inputs;
+      vecdo outputs;
+      std::chrono::steady_clock::time_point read;
+   };
+
+   struct Pipeline {
+      std::mutex mutex;
+      std::condition_variable work;     // a batch to compute, or the end
+      std::condition_variable computed; // a batch for the writer
+      std::condition_variable room;     // fewer batches in flight
+      std::deque< std::unique_ptr< Batch > > todo;
+      std::map< uint64_t, std::unique_ptr< Batch > > done;
+      size_t inFlight = 0;
+      bool ended = false;  // nothing more will be read
+      uint64_t read = 0;   // batches read
+   };
+
+   double percentile(const std::vector< double >& sorted, const double p) {
+      if (sorted.empty()) { return 0.0; }
+      const auto i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+      return sorted[std::min(i, sorted.size() - 1)];
+   }
+}
+
+bool Infer::stream(const Model::Mapped& model,
+                   FILE *in,
+                   FILE *out,
+                   const size_t batchSize,
+                   const unsigned int threads,
+                   Report& report) {
+   const size_t stride = model.header().inputNodes;
+   const size_t inputs = stride - 1;
+   const size_t capacity = 4 * static_cast<size_t>(threads);
+   const auto start = std::chrono::steady_clock::now();
+   // Read and write in large chunks
+   setvbuf(in, nullptr, _IOFBF, 1 << 20);
+   setvbuf(out, nullptr, _IOFBF, 1 << 20);
+
+   Pipeline p;
+   std::vector< std::thread > workers;
+   for (unsigned int t = 0; t < threads; t++) {
+      workers.emplace_back([&p, &model] {
+         std::unique_lock< std::mutex > lock(p.mutex);
+         while (true) {
+            p.work.wait(lock, [&p] { return !p.todo.empty() || p.ended; });
+            if (p.todo.empty()) { return; }
+            std::unique_ptr< Batch > b = std::move(p.todo.front());
+            p.todo.pop_front();
+            lock.unlock();
+            model.forward(b->inputs.data(), b->count, b->outputs.data());
+            lock.lock();
+            const uint64_t number = b->number;
+            p.done.emplace(number, std::move(b));
+            p.computed.notify_one();
+         }
+      });
+   }
+
+   std::vector< double > latencies;
+   std::thread writer([&] {
+      uint64_t next = 0;
+      std::unique_lock< std::mutex > lock(p.mutex);
+      while (true) {
+         p.computed.wait(lock, [&] {
+            return p.done.count(next) > 0 || (p.ended && next == p.read);
+         });
+         if (p.done.count(next) == 0) { return; }
+         std::unique_ptr< Batch > b = std::move(p.done[next]);
+         p.done.erase(next);
+         lock.unlock();
+         for (size_t c = 0; c < b->count; c++) {
+            fprintf(out, "%.17g\n", General::sigmoid(b->outputs[c]));
+         }
+         latencies.push_back(std::chrono::duration< double, std::milli >(
+                                std::chrono::steady_clock::now() - b->read).count());
+         report.cases += b->count;
+         next++;
+         lock.lock();
+         p.inFlight--;
+         p.room.notify_one();
+      }
+   });
+
+   // Read the batches on this thread
+   bool valid = true;
+   char *line = nullptr;
+   size_t lineSize = 0;
+   uint64_t lineNumber = 0;
+   std::unique_ptr< Batch > batch;
+   const auto hand = [&] {
+      batch->read = std::chrono::steady_clock::now();
+      std::unique_lock< std::mutex > lock(p.mutex);
+      p.room.wait(lock, [&] { return p.inFlight < capacity; });
+      p.inFlight++;
+      p.read++;
+      p.todo.push_back(std::move(batch));
+      p.work.notify_one();
+   };
+   while (getline(&line, &lineSize, in) > 0) {
+      lineNumber++;
+      const char *c = line;
+      while (*c == ' ' || *c == '\t') { c++; }
+      if (*c == '\n' || *c == '\0' || *c == '#') { continue; }
+      if (!batch) {
+         batch.reset(new Batch());
+         batch->number = p.read;
+         batch->inputs.resize(batchSize * stride);
+         batch->outputs.resize(batchSize);
+      }
+      double *values = batch->inputs.data() + batch->count * stride;
+      size_t amount = 0;
+      char *end;
+      for (double v = strtod(c, &end); end != c; v = strtod(c, &end)) {
+         if (amount < inputs) { values[amount] = v; }
+         amount++;
+         c = end;
+      }
+      while (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n') { c++; }
+      if (amount != inputs || *c != '\0') {
+         fprintf(stderr, "Line %llu of the input should hold %zu numbers!\n",
+                 static_cast<unsigned long long>(lineNumber), inputs);
+         valid = false;
+         break;
+      }
+      //bias has value -1
+      values[inputs] = -1.0;
+      if (++batch->count == batchSize) { hand(); }
+   }
+   free(line);
+   if (batch && batch->count > 0 && valid) { hand(); }
+   {
+      std::lock_guard< std::mutex > lock(p.mutex);
+      p.ended = true;
+   }
+   p.work.notify_all();
+   p.computed.notify_all();
+   for (std::thread& w : workers) { w.join(); }
+   writer.join();
+   fflush(out);
+
+   report.batches = latencies.size();
+   report.seconds = std::chrono::duration< double >(
+                       std::chrono::steady_clock::now() - start).count();
+   std::sort(latencies.begin(), latencies.end());
+   report.p50 = percentile(latencies, 0.50);
+   report.p90 = percentile(latencies, 0.90);
+   report.p99 = percentile(latencies, 0.99);
+   report.max = latencies.empty() ? 0.0 : latencies.back();
+   return valid;
+}
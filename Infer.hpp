@@ -0,0 +1,40 @@
+#ifndef INFER_HPP
+#define INFER_HPP
+
+#include "Includes.hpp"
+
+#include "Model.hpp"
+
+namespace Infer {
+   /*
+    * Predictions of a saved model for a stream of cases. Each line
+    * of the input holds the inputs of one case, without the bias
+    * node, separated by spaces; empty lines and lines starting with
+    * # are skipped. Each line of the output holds the prediction,
+    * between 0 and 1, for the case on the same line of the input.
+    * The cases are read in batches. Worker threads compute the
+    * batches while the next ones are read, and a writer puts the
+    * predictions out in the order of the input. At most a few
+    * batches per worker are in flight, so the memory use does not
+    * depend on the size of the input.
+    */
+
+   struct Report {
+      uint64_t cases = 0;
+      uint64_t batches = 0;
+      double seconds = 0.0;
+      // Milliseconds from reading a batch to writing its predictions
+      double p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+   };
+
+   // Predict every case of in and write the predictions to out.
+   // Returns false, after a message, if the input is malformed.
+   bool stream(const Model::Mapped& model,
+               FILE *in,
+               FILE *out,
+               size_t batchSize,
+               unsigned int threads,
+               Report& report);
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include "Includes.hpp"
+
+namespace Kernels {
+   /*
+    * The products of a layer of weights with a layer of nodes.
+    * The weights are stored per row (the node the edge starts at),
+    * so all loops run along the rows, and the innermost loop walks
+    * through memory contiguously.
+    * Every kernel does its additions in the same order as the plain
+    * loop would, so the results are exactly the same.
+    */
+
+   // The amount of columns processed at once. A tile of the output
+   // (4 KiB) then stays in the L1 cache while all rows pass by.
+   const size_t columnTile = 512;
+
+   template < typename Row >
+   inline void multiplyAddRows(const Row row,
+                               const double *a,
+                               const size_t rows,
+                               const size_t cols,
+                               double *out) {
+      /*
+       * out[j] += a[0] * w[0][j] + ... + a[rows-1] * w[rows-1][j]
+       * for every j < cols, where row(i) gives the start of w[i].
+       * Within a tile four rows are handled at once, so each
+       * element of out is loaded and stored once per four rows.
+       */
+      for (size_t j0 = 0; j0 < cols; j0 += columnTile) {
+         const size_t j1 = std::min(cols, j0 + columnTile);
+         size_t i = 0;
+         for (; i + 4 <= rows; i += 4) {
+            const double a0 = a[i],     a1 = a[i + 1],
+                         a2 = a[i + 2], a3 = a[i + 3];
+            const double *w0 = row(i),     *w1 = row(i + 1),
+                         *w2 = row(i + 2), *w3 = row(i + 3);
+            for (size_t j = j0; j < j1; j++) {
+               double o = out[j];
+               o += w0[j] * a0;
+               o += w1[j] * a1;
+               o += w2[j] * a2;
+               o += w3[j] * a3;
+               out[j] = o;
+            }
+         }
+         for (; i < rows; i++) {
+            const double ai = a[i];
+            const double *wi = row(i);
+            for (size_t j = j0; j < j1; j++) { out[j] += wi[j] * ai; }
+         }
+      }
+   }
+
+   inline void multiplyAdd(const vecvecdo& w,
+                           const double *a,
+                           const size_t rows,
+                           const size_t cols,
+                           double *out) {
+      multiplyAddRows([&w](const size_t i) { return w[i].data(); },
+                      a, rows, cols, out);
+   }
+
+   inline void multiplyAdd(const double *w,
+                           const size_t stride,
+                           const double *a,
+                           const size_t rows,
+                           const size_t cols,
+                           double *out) {
+      // For weights stored in one block, stride doubles per row
+      multiplyAddRows([w, stride](const size_t i) { return w + i * stride; },
+                      a, rows, cols, out);
+   }
+
+   inline void multiplyRows(const vecvecdo& w,
+                            const double *d,
+                            const size_t rows,
+                            const size_t cols,
+                            double *out) {
+      /*
+       * out[i] += w[i][0] * d[0] + ... + w[i][cols-1] * d[cols-1]
+       * for every i < rows.
+       */
+      for (size_t i = 0; i < rows; i++) {
+         const double *wi = w[i].data();
+         double o = out[i];
+         for (size_t j = 0; j < cols; j++) { o += wi[j] * d[j]; }
+         out[i] = o;
+      }
+   }
+
+   inline void outerAdd(vecvecdo& g,
+                        const double *a,
+                        const double *d,
+                        const size_t rows,
+                        const size_t cols) {
+      /*
+       * g[i][j] += a[i] * d[j] for every i < rows and j < cols.
+       */
+      for (size_t i = 0; i < rows; i++) {
+         const double ai = a[i];
+         double *gi = g[i].data();
+         for (size_t j = 0; j < cols; j++) { gi[j] += ai * d[j]; }
+      }
+   }
+
+   struct Sparse {
+      /*
+       * The positions of the nonzero weights of a layer, stored per
+       * row in compressed sparse row (CSR) format. The weights
+       * themselves stay in the dense layer, so training keeps
+       * updating them in place.
+       * active tells whether the layer is sparse enough for the
+       * sparse kernels to be faster than the dense ones.
+       */
+      std::vector< uint32_t > rowStart; // one more than the amount of rows
+      std::vector< uint32_t > columns;  // ascending within every row
+      bool active = false;
+
+      void build(const vecvecdo& w) {
+         rowStart.assign(1, 0);
+         columns.clear();
+         for (const vecdo& row : w) {
+            for (size_t j = 0; j < row.size(); j++) {
+               if (row[j] != 0.0) { columns.push_back(static_cast<uint32_t>(j)); }
+            }
+            rowStart.push_back(static_cast<uint32_t>(columns.size()));
+         }
+      }
+
+      size_t nonZero() const { return columns.size(); }
+   };
+
+   inline void multiplyAdd(const vecvecdo& w,
+                           const Sparse& s,
+                           const double *a,
+                           const size_t rows,
+                           const size_t cols,
+                           double *out) {
+      // The same as the dense multiplyAdd, skipping the zero weights.
+      for (size_t i = 0; i < rows; i++) {
+         const double ai = a[i];
+         const double *wi = w[i].data();
+         for (uint32_t k = s.rowStart[i]; k < s.rowStart[i + 1]; k++) {
+            const uint32_t j = s.columns[k];
+            if (j >= cols) { break; }
+            out[j] += wi[j] * ai;
+         }
+      }
+   }
+
+   inline void multiplyRows(const vecvecdo& w,
+                            const Sparse& s,
+                            const double *d,
+                            const size_t rows,
+                            const size_t cols,
+                            double *out) {
+      // The same as the dense multiplyRows, skipping the zero weights.
+      for (size_t i = 0; i < rows; i++) {
+         const double *wi = w[i].data();
+         double o = out[i];
+         for (uint32_t k = s.rowStart[i]; k < s.rowStart[i + 1]; k++) {
+            const uint32_t j = s.columns[k];
+            if (j >= cols) { break; }
+            o += wi[j] * d[j];
+         }
+         out[i] = o;
+      }
+   }
+
+   inline void outerAdd(vecvecdo& g,
+                        const Sparse& s,
+                        const double *a,
+                        const double *d,
+                        const size_t rows,
+                        const size_t cols) {
+      // Only the positions of nonzero weights get a direction, so
+      // pruned weights stay zero.
+      for (size_t i = 0; i < rows; i++) {
+         const double ai = a[i];
+         double *gi = g[i].data();
+         for (uint32_t k = s.rowStart[i]; k < s.rowStart[i + 1]; k++) {
+            const uint32_t j = s.columns[k];
+            if (j >= cols) { break; }
+            gi[j] += ai * d[j];
+         }
+      }
+   }
+}
+
+#endif
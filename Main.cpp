@@ -1,20 +1,47 @@
 #include "Includes.hpp"
 
-#include "General.cpp"
+#include "Activation.hpp"
+#include "Allocator.hpp"
+#include "Cache.hpp"
+#include "Catalogue.hpp"
+#include "Dln.hpp"
+#include "Evaluator.hpp"
+#include "General.hpp"
+#include "Infer.hpp"
+#include "Model.hpp"
 #include "Network.hpp"
+#include "Placement.hpp"
+#include "Quantised.hpp"
+#include "Progress.hpp"
+#include "Results.hpp"
+#include "Search.hpp"
+#include "Shard.hpp"
+#include "Statistics.hpp"
+#include "Sweep.hpp"
 #include "Tests.hpp"
+#include "Trace.hpp"
+#include "Validation.hpp"
 
 /*// Global variables to enable multithreading
 unordered_set<std::string> globalSchemes;
 mutex mtx;*/
-float progress = 0.0; //for the progressbar
+Progress progress; //for the progressbar and the metrics
+Cache cache; //the results of earlier jobs
+Evaluator evaluator; //tests the checkpoints while training goes on
+Results results; //the single results file of a sweep spec
+Statistics statistics; //the final errors of every scheme over the seeds
+// The held-out cases of every test, made when first needed
+std::map< std::string, std::unique_ptr< Validation > > validations;
+std::mutex validationsMutex;
+// Whether a worker stopped on an error, so the run fails
+bool workerFailed = false;
 
 struct InputArgs {
    bool schemes;
-   uint8_t layers;
-   uint8_t inputnodes;
-   uint8_t hiddennodes;
-   uint8_t outputnodes;
+   uint32_t layers;
+   uint32_t inputnodes;
+   uint32_t hiddennodes;
+   uint32_t outputnodes;
    uint64_t epochs;
    double alpha;
    uint16_t seed;
@@ -22,39 +49,67 @@ struct InputArgs {
    std::string test;
    bool toFile;
    std::string folder;
+   std::string traceFile;
+   std::string metricsFile;
+   unsigned int metricsInterval;
+   Shard::Spec shard;
+   uint32_t launchShards;
+   uint32_t mergeShards;
+   bool safeNumerics;
+   Optimizer optimizer;
+   Schedule schedule;
+   double targetError;
+   bool randomWeights;
+   uint32_t batchSize;
+   unsigned int trainThreads;
+   Network::Parallel parallel;
+   double pruneThreshold;
+   std::set<uint64_t> pruneEpochs;
+   double sparseCutoff;
+   bool quantise;
+   bool saveModel;
+   std::string loadModel;
+   std::string catalogueFile;
+   Placement::Mode placement;
+   Activation::Type activation;
+   bool compareActivations;
+   bool scaling;
+   uint32_t evalQueue;
+   std::string sweepFile;
+   std::string cacheFolder;
+   uint64_t searchBudget;
+   bool dumps;
+   size_t topSchemes;
+   uint64_t adaptiveBudget;
+   uint64_t warmEpochs;
+   size_t validateCases;
 };
 
-vecdo initialiseWeightsByScheme(const std::string& scheme,
-                                const unsigned int seed,
-                                const unsigned int shuffleSeed) {
+// The same held-out cases for every network, whatever the seed
+const uint32_t validationSeed = 1;
+
+const Validation *validation(const InputArgs& ia) {
    /*
-    * Function takes a scheme in format "aaabbbcccddd" etc,
-    * where equal letters represent the same 'random' 
-    * weight in that position.
-    * Then it makes a vector of equal length with on each
-    * position a 'random' weight, according to this scheme.
-    * If we want to perform a different permutation of weights,
-    * this is applied by shuffling the weights. A seed of 1
-    * just reverses the vector.
+    * The held-out cases of the test of ia, or nullptr without
+    * --validate. They are made by the first worker asking for
+    * them and shared by all others.
     */
-   char current = scheme[0];
-   vecdo weights(scheme.length(), -1.0);
-   weights[0] = General::randomWeight(seed);
-   for (unsigned int i = 1; i < scheme.length(); i++) {
-      if (current == scheme[i]) {
-         weights[i] = weights[i-1];
-      } else {
-         weights[i] = General::trueRandomWeight(seed, weights);
-      }
-      current = scheme[i];
-   }
-   if (shuffleSeed == 1) {
-      std::reverse(weights.begin(), weights.end());
-   }
-   if (shuffleSeed > 1) {
-      std::shuffle(weights.begin(), weights.end(), std::default_random_engine(shuffleSeed));
+   if (ia.validateCases == 0) { return nullptr; }
+   std::lock_guard< std::mutex > lock(validationsMutex);
+   std::unique_ptr< Validation >& v = validations[ia.test];
+   if (!v) { v.reset(new Validation(ia.test, ia.validateCases, validationSeed)); }
+   return v.get();
+}
+
+void reportValidations() {
+   for (const auto& v : validations) {
+      const uint64_t evaluated = v.second->evaluated();
+      fprintf(stderr, "\nValidated %llu networks on %zu held-out %s cases, "
+                      "%.3f ms per network.",
+              static_cast<unsigned long long>(evaluated), v.second->size(),
+              v.first.c_str(),
+              evaluated > 0 ? 1000.0 * v.second->seconds() / evaluated : 0.0);
    }
-   return weights;
 }
 
 inline void pullScheme(Network& n) {
@@ -64,145 +119,149 @@ inline void pullScheme(Network& n) {
     * small nudge to come closer to each other.
     * The nudge is half the distance to the average of their weights.
     */
-    std::string scheme = n.scheme();
-    auto schemeLength = static_cast<unsigned int>(scheme.length());
-    vecdo weightSums(schemeLength, 0.0);
-    auto wFIFlat = General::flatten(n.weightsFromInputs());
-    auto wHLFlat = General::flatten(n.weightsHiddenLayers());
-    auto wTOFlat = General::flatten(n.weightsToOutput());
-    vecdo allWeightsFlat = General::flatten({wFIFlat, wHLFlat, wTOFlat});
-    std::vector<unsigned int> letterCount(schemeLength, 0);
-    unsigned int index = 0;
-    
-    for (unsigned int i = 0; i < schemeLength; i++) {
-       index = static_cast<unsigned int>(scheme[i] - 'A');
-       weightSums[index] += allWeightsFlat[i];
-       letterCount[index]++;
+    const std::string scheme = n.scheme();
+    Catalogue::Labels labels;
+    for (const char letter : scheme) {
+       labels.push_back(static_cast<uint32_t>(letter - 'A'));
     }
-    
-    // Take the averages of the weightSums
-    vecdo weightAverages(schemeLength, 0.0);
-    for (unsigned int j = 0; j < schemeLength; j++) {
-       index = static_cast<unsigned int>(scheme[j] - 'A');
-       weightAverages[index] = letterCount[index] > 0 ? weightSums[index] / 
-       letterCount[index] : 0;
-    }
-    
-    // Then use these to nudge the weights
-    for (unsigned int k = 0; k < schemeLength; k++) {
-      index = static_cast<unsigned int>(scheme[k] - 'A');
-      allWeightsFlat[k] -= (allWeightsFlat[k] - 
-                            weightAverages[index]) / 2.0;
-    }
-    
-    // Then update the weights according to the flat weight vector
+    // The scheme weights line up with the labels, bias weights included
+    vecdo weights = n.schemeWeights();
+    Dln::tie(weights, labels, 0.5);
     n.initialiseWeights(0, //seed (not relevant in this case)
-                        allWeightsFlat); //scheme weights
+                        weights); //scheme weights
+}
+
+Dln::Config config(const InputArgs& ia) {
+   // The parts of the arguments the library needs
+   Dln::Config c;
+   c.test        = ia.test;
+   c.layers      = ia.layers;
+   c.hidden      = ia.hiddennodes - 1;
+   c.alpha       = ia.alpha;
+   c.activation  = ia.activation;
+   c.optimizer   = ia.optimizer;
+   c.schedule    = ia.schedule;
+   c.shuffleSeed = ia.shuffleSeed;
+   return c;
 }
 
 Network makeNetwork(const InputArgs& ia,
                     const uint16_t seed,
+                    const Catalogue::Labels& labels = {},
                     const std::string& scheme = "") {
-   /*
-    * Construct a network using the parameters.
-    * This is basically only calling the functions
-    * which set the weights.
-    * If a scheme is used, first schemeVector is filled
-    * so that the scheme is reflected in the weights.
-    * The '+ 1' after inputs and hiddenNodes is to account
-    * for the bias nodes, which are added to the network.
-    */
-   vecvecdo wFI(ia.inputnodes, vecdo(ia.hiddennodes));
-   std::vector< vecvecdo > wHL(ia.layers,
-                          vecvecdo(ia.hiddennodes,
-                                   vecdo(ia.hiddennodes)));
-   vecvecdo wTO(ia.hiddennodes, vecdo(ia.outputnodes));
-   vecdo inputLayer(ia.inputnodes);
-   vecvecdo hiddenLayers(ia.layers,
-                         vecdo(ia.hiddennodes));
-   for (vecdo& layer : hiddenLayers) {
-      // The value is actually never used, but it gives a better view
-      // of what's happening when the graph is drawn.
-      layer[ia.hiddennodes - 1] = -1.0;
-   }
-   vecdo schemeVector = {};
-   if (scheme.length() > 0) {
-      schemeVector = initialiseWeightsByScheme(scheme, seed, ia.shuffleSeed);
-   }
-   
-   // Here we construct a temporary network and feed it to this function
-   Network tempNetwork(vecdo(ia.inputnodes),
-                       wFI,
-                       hiddenLayers,
-                       wHL,
-                       wTO,
-                       0.0,
-                       ia.alpha,
-                       0.0,
-                       scheme);
-   
-   tempNetwork.initialiseWeights(seed, //seed
-                                 schemeVector); //scheme weights
-
-   return tempNetwork;
+   return Dln::build(config(ia), seed, labels, scheme);
 }
 
-std::unordered_set<std::string> generateInitialSchemes(std::string scheme, 
-                                                       uint8_t multitask = 0) {
+void testNodes(InputArgs& ia) {
+   // Unknown tests are left to the checks further on
+   if (Dln::inputs(ia.test) > 0) {
+      ia.inputnodes = Dln::inputs(ia.test);
+      ia.outputnodes = Dln::outputs(ia.test);
+   }
+}
+
+bool singleOutput(const InputArgs& ia) {
+   // -q, --save-model, --load-model and --validate handle one output
+   if (ia.outputnodes > 1 &&
+       (ia.quantise || ia.saveModel || !ia.loadModel.empty() || ia.validateCases > 0)) {
+      fprintf(stderr, "The %s test has %u outputs, but -q, --save-model, --load-model "
+                      "and --validate need a single one!\n",
+              ia.test.c_str(), ia.outputnodes);
+      return false;
+   }
+   return true;
+}
+
+void joinWorkers(std::vector< std::future< void > >& threads) {
    /*
-    * First generate all the needed schemes.
-    * This may get hard for larger collections of weights
-    * due to ASCII limitations, but when limited to about
-    * 50 different possible weights this should work.
-    * Each element in the scheme string may not be larger
-    * than its index + 'A', so that there will be no
-    * duplicate schemes.
+    * Wait for every worker. The error a worker stopped on is
+    * printed and fails the run, instead of being lost with its
+    * future.
     */
-   std::unordered_set<std::string> schemes = {scheme};
-   std::unordered_set<std::string> newSchemes;
-   const auto schemeLength = static_cast<uint16_t>(scheme.length());
-   for (int i = schemeLength - 1; i >= multitask; i--) {
-      scheme[i]++;
-      if (scheme[i] > ('A' + i) ||
-         (i > 0 && scheme[i] >
-                   (scheme[i-1] + 1))) {
-         return schemes;
+   for (auto& thread : threads) {
+      try {
+         thread.get();
+      } catch (std::exception& e) {
+         fprintf(stderr, "\nA worker stopped: %s\n", e.what());
+         workerFailed = true;
       }
-      schemes.insert(scheme);
-      newSchemes = generateInitialSchemes(scheme);
-      schemes.reserve(schemes.size() +
-                      distance(newSchemes.begin(), newSchemes.end()));
-      schemes.insert(newSchemes.begin(), newSchemes.end());
    }
-   return schemes;
 }
 
-/*unordered_set<std::string> multiTaskSchemes(uint16_t length) {
-   *//*
-    * Generate the schemes using threads, so it will take less time.
-    *//*
-   unordered_set<std::string> allSchemes = {};
-   char startLetter = 'A';
-   std::string startScheme;
-   std::vector< future< void > > threads(length);
-   for(uint16_t i = 0; i < length; i++) {
-      startScheme = startLetter * length;
-      threads[i] = async(launch::async,
-                         [allSchemes,
-                          startScheme]
-                         {
-         generateInitialSchemes(startScheme, 1); 
-      });
-      // TODO Some way to stitch those together
-   }
-}*/
-
-void run(Network n,
+uint64_t amountWeights(const InputArgs& ia) {
+   return Dln::weights(config(ia));
+}
+
+std::string resultFile(const InputArgs& ia, const std::string& scheme) {
+   return ia.folder                                  +
+          "w" + scheme                               +
+          "e" + std::to_string(ia.epochs)            +
+          "a" + General::to_string_prec(ia.alpha, 2) +
+          "i" + std::to_string(ia.inputnodes)        +
+          "l" + std::to_string(ia.layers)            +
+          "h" + std::to_string(ia.hiddennodes)       +
+          "o" + std::to_string(ia.outputnodes)       +
+          "." + ia.test                              + 
+          "output";
+}
+
+const char *resultColumns = "test layers hidden alpha epochs scheme epoch seed";
+
+std::string resultRow(const InputArgs& ia,
+                      const std::string& scheme,
+                      const uint64_t epoch,
+                      const uint16_t seed) {
+   // A row of the results store, without the error
+   return ia.test                                 + " " +
+          std::to_string(ia.layers)               + " " +
+          std::to_string(ia.hiddennodes - 1)      + " " +
+          General::to_string_prec(ia.alpha, 2)    + " " +
+          std::to_string(ia.epochs)               + " " +
+          (scheme.empty() ? "-" : scheme)         + " " +
+          std::to_string(epoch)                   + " " +
+          std::to_string(seed);
+}
+
+std::string jobKey(const InputArgs& ia,
+                   const uint16_t seed,
+                   const std::string& scheme,
+                   const double target,
+                   const bool nudgetest) {
+   // Everything which influences the results of a job, for the cache
+   std::ostringstream key;
+   key << std::setprecision(17)
+       << "test=" << ia.test
+       << " layers=" << ia.layers
+       << " hidden=" << ia.hiddennodes
+       << " inputs=" << ia.inputnodes
+       << " outputs=" << ia.outputnodes
+       << " epochs=" << ia.epochs
+       << " alpha=" << ia.alpha
+       << " seed=" << seed
+       << " shuffle=" << ia.shuffleSeed
+       << " scheme=" << (scheme.empty() ? "-" : scheme)
+       << " random=" << ia.randomWeights
+       << " activation=" << Activation::name(ia.activation)
+       << " optimizer=" << ia.optimizer.type() << "," << ia.optimizer.beta1()
+       << " schedule=" << ia.schedule.type() << "," << ia.schedule.warmup()
+                       << "," << ia.schedule.stepSize() << "," << ia.schedule.gamma()
+       << " batch=" << ia.batchSize
+       << " threads=" << ia.trainThreads
+       << " parallel=" << ia.parallel
+       << " target=" << target
+       << " nudge=" << nudgetest
+       << " safe=" << ia.safeNumerics
+       << " dumps=" << ia.dumps;
+   return key.str();
+}
+
+void run(Network& n,
          const InputArgs& ia,
          const uint16_t seed,
          std::string fileName,
          const bool convergenceTest = false,
-         const bool nudgetest = false) {
+         const bool nudgetest = false,
+         const std::function< void(double) >& finished = nullptr) {
 
    //TODO: Assumes usage of schemes, might want code which does not.
    
@@ -210,15 +269,33 @@ void run(Network n,
     * Given the Network, train the network on the
     * XOR problem in the given amount of epochs.
     * Afterwards, call the function to test it.
+    * If a target error is given, or convergenceTest is set,
+    * training stops as soon as the error is below the target
+    * (or 0.1), and the time it took is reported.
+    * The checkpoints are tested by the evaluator, on snapshots of
+    * the network, while training goes on. In a sweep from a spec
+    * they go to the results store, as a row each.
+    * A job which is in the cache is not trained, its results are
+    * written as they were the first time.
+    * Outside a sweep spec the final error goes to the statistics of
+    * the scheme, and without dumps it is the only one tested.
+    * finished, if given, is called with the final error.
+    * n is trained in place, it usually comes from a Dln::Pool.
+    * With --validate the final network is also checked on the
+    * held-out cases, reported next to the results.
     */
    vecdo inputVector;
-   double expectedOutput;
+   vecdo expectedOutputs;
+   vecvecdo batchInputs(ia.batchSize);
+   vecvecdo batchExpected(ia.batchSize);
    uint64_t currentEpoch = 0;
+   uint64_t reportedEpoch = 0; // epochs already counted by progress
    
    const std::unordered_set< std::string > acceptableTests = {
       // Might be lengthier in the future
       "xor",
-      "abc"
+      "abc",
+      "gates"
    };
    
    assert(acceptableTests.find(ia.test) != acceptableTests.end() &&
@@ -226,102 +303,732 @@ void run(Network n,
    
    Tests tests;
    double error;
+   const bool converge = convergenceTest || ia.targetError > 0.0;
+   const double target = ia.targetError > 0.0 ? ia.targetError : 0.1;
+   const auto started = std::chrono::steady_clock::now();
    
    if (fileName.empty()) { fileName = "simple." + ia.test + "output"; }
    const char *writeMode = "a";
    Tests::TestParameters param(n, ia.toFile, fileName, writeMode, true, seed, "");
+   
+   const bool stored = !ia.sweepFile.empty();
+   // Whether the checkpoints before the last are tested
+   const bool dumps = ia.dumps || stored;
+   const std::string scheme = n.scheme();
+   // Networks with random weights have no scheme, "-" as in the rows
+   const std::string summarised = scheme.empty() ? "-" : scheme;
+   const auto row = [&](const uint64_t epoch) {
+      return stored ? resultRow(ia, scheme, epoch, seed) : std::string();
+   };
+   
+   // All files of the run are named after the epoch they are for
+   uint64_t fileEpoch = ia.epochs;
+   const auto fileAt = [&](const uint64_t epoch) {
+      fileEpoch = epoch;
+      if (!param.fileName.empty()) {
+         param.fileName = regex_replace(fileName,
+                                        std::regex("e" +
+                                                   std::to_string(ia.epochs)),
+                                        "e" + std::to_string(epoch));
+      }
+   };
+   
+   // The side reports need the network, so those jobs always train
+   std::shared_ptr< Cache::Pending > pending;
+   if (cache.enabled() && !ia.quantise && !ia.saveModel && ia.pruneThreshold <= 0.0 &&
+       ia.validateCases == 0) {
+      const std::string key = jobKey(ia, seed, scheme, converge ? target : 0.0,
+                                     nudgetest);
+      std::vector< Cache::Result > earlier;
+      if (cache.find(key, earlier)) {
+         for (const Cache::Result& r : earlier) {
+            fileAt(r.fileEpoch);
+            if (stored) {
+               results.append(row(r.epoch), r.error);
+            } else if (dumps) {
+               tests.printError(param, ia.test, r.error);
+            }
+         }
+         if (!stored) { statistics.add(summarised, earlier.back().error); }
+         if (finished) { finished(earlier.back().error); }
+         progress.addEpochs(earlier.back().epoch);
+         return;
+      }
+      pending = cache.record(key);
+   }
+   const auto publish = [&](const uint64_t epoch, const bool last) {
+      const std::shared_ptr< Cache::Pending > job = pending;
+      const size_t slot = job ? job->reserve(fileEpoch, epoch) : 0;
+      const bool summarise = last && !stored;
+      const std::function< void(double) > done = last ? finished : nullptr;
+      std::function< void(double) > tested;
+      if (job || summarise || done) {
+         tested = [job, slot, summarise, summarised, done](const double error) {
+            if (job) { job->set(slot, error); }
+            if (summarise) { statistics.add(summarised, error); }
+            if (done) { done(error); }
+         };
+      }
+      evaluator.publish(param, ia.test, row(epoch), std::move(tested));
+   };
+   
+   // Start of the current stretch of training, for the trace
+   uint64_t trainStart = Trace::enabled() ? Trace::now() : 0;
 
    while (currentEpoch < ia.epochs) {
-      tests.runSmallTest(inputVector, expectedOutput, ia.test);
-      n.inputs(inputVector);
-      n.expectedOutput(expectedOutput);
-      n.train();
-      param.network = n;
+      n.alpha(ia.schedule.alpha(ia.alpha, currentEpoch, ia.epochs));
+      if (ia.batchSize > 1) {
+         for (uint32_t c = 0; c < ia.batchSize; c++) {
+            tests.runSmallTest(batchInputs[c], batchExpected[c], ia.test);
+         }
+         n.trainBatch(batchInputs, batchExpected, ia.trainThreads, ia.parallel);
+      } else {
+         tests.runSmallTest(inputVector, expectedOutputs, ia.test);
+         n.inputs(inputVector);
+         n.expectedOutputs(expectedOutputs);
+         n.train();
+      }
+      
+      if (n.diverged()) {
+         // Abandon this run, the last result printed shows the NaN error
+         fprintf(stderr, "Scheme %s with seed %u diverged at epoch %llu "
+                         "(%llu saturated nodes), abandoning it.\n",
+                 n.scheme().c_str(), seed,
+                 static_cast<unsigned long long>(currentEpoch),
+                 static_cast<unsigned long long>(n.saturated()));
+         progress.divergedJob();
+         break;
+      }
+      
+      if (ia.pruneThreshold > 0.0 && ia.pruneEpochs.count(currentEpoch) > 0) {
+         param.network = n;
+         const double before = tests.runTest(param, ia.test, false);
+         n.prune(ia.pruneThreshold, ia.sparseCutoff);
+         param.network = n;
+         fileAt(currentEpoch);
+         tests.reportPruning(param, ia.test, before,
+                             tests.runTest(param, ia.test, false));
+      }
 
-      if (convergenceTest && currentEpoch % 10 == 0) {
+      if (converge && currentEpoch % 10 == 0) {
+         param.network = n;
          error = tests.runTest(param, ia.test, false);
-         if (error < 0.1) {
-            if (!param.fileName.empty()) {
-            param.fileName = regex_replace(fileName,
-                                           std::regex("e" +
-                                                      std::to_string(ia.epochs)),
-                                           "e" + std::to_string(currentEpoch));
-            }
-            tests.runTest(param, ia.test, true); //to print the result
+         if (error < target) {
+            fprintf(stderr, "Scheme %s with seed %u (%s) reached error %f at "
+                            "epoch %llu after %.2f ms.\n",
+                    n.scheme().c_str(), seed,
+                    Activation::name(n.activation()).c_str(), error,
+                    static_cast<unsigned long long>(currentEpoch),
+                    std::chrono::duration< double, std::milli >(
+                       std::chrono::steady_clock::now() - started).count());
+            fileAt(currentEpoch);
+            // A store gets the row of the result below only
+            if (dumps && !stored) { publish(currentEpoch, false); } //to print the result
             break;
          }
       }
       if (currentEpoch % (ia.epochs / 20) == 0) {
-         if (!param.fileName.empty()) {
-            param.fileName = regex_replace(fileName,
-                                           std::regex("e" +
-                                                      std::to_string(ia.epochs)),
-                                           "e" + std::to_string(currentEpoch));
+         Trace::record("train", "train", trainStart, seed);
+         Trace::Span span("checkpoint", "test", seed);
+         progress.addEpochs(currentEpoch - reportedEpoch);
+         reportedEpoch = currentEpoch;
+         fileAt(currentEpoch);
+         // The snapshot is taken before the nudge
+         if (dumps) {
+            param.network = n;
+            publish(currentEpoch, false);
          }
          if (nudgetest && currentEpoch > 0) { pullScheme(n); }
-         tests.runTest(param, ia.test, true);
          //n.writeDot(param.fileName + ".dot");
+         trainStart = Trace::enabled() ? Trace::now() : 0;
       }
       currentEpoch++;
    }
+   progress.addEpochs(currentEpoch - reportedEpoch);
    //also print the last result
-   tests.runTest(param, ia.test, true);
+   Trace::record("train", "train", trainStart, seed);
+   Trace::Span span("checkpoint", "test", seed);
+   param.network = n;
+   publish(currentEpoch, true);
+   if (pending) { pending->complete(); }
+   if (ia.quantise) { tests.reportQuantisation(param, ia.test); }
+   const Validation *heldOut = validation(ia);
+   if (heldOut != nullptr && !n.diverged()) {
+      const double trained = std::chrono::duration< double >(
+                                std::chrono::steady_clock::now() - started).count();
+      tests.reportValidation(param, ia.test, heldOut->evaluate(n, ia.trainThreads),
+                             trained);
+   }
+   if (ia.saveModel) {
+      std::string modelName = fileName;
+      modelName.replace(modelName.find("." + ia.test + "output"),
+                        std::string::npos,
+                        "d" + std::to_string(seed) + ".model");
+      Model::save(n, modelName);
+   }
 }
 
-void runSchemes(const std::unordered_set<std::string>& schemes,
+void runSchemes(const Catalogue& catalogue,
                 const InputArgs& ia,
-                const uint16_t seed) {
+                const uint16_t seed,
+                const uint64_t seedIndex) {
    /*
-    * Given the set of schemes, run an identical network
-    * on each of the schemes for the given seed.
+    * Given the catalogue of schemes, run an identical network
+    * on each of the schemes of this shard for the given seed.
+    * The jobs are numbered seed-major over the catalogue, so
+    * every process agrees on which jobs belong to which shard.
     * It also creates the name of the file for the results
     * to be written to.
     */
    std::string fileName;
+   Catalogue::Labels labels;
+   Dln::Pool pool(config(ia));
    __attribute__((unused)) const auto unused =
-               static_cast<uint16_t>(system(("mkdir " +
+               static_cast<uint16_t>(system(("mkdir -p " +
                                              ia.folder +
                                              " 2> /dev/null").c_str()));
-   for(const std::string& scheme : schemes) {
-      fileName = ia.folder                                  +
-                 "w" + scheme                               +
-                 "e" + std::to_string(ia.epochs)            +
-                 "a" + General::to_string_prec(ia.alpha, 2) +
-                 "i" + std::to_string(ia.inputnodes)        +
-                 "l" + std::to_string(ia.layers)            +
-                 "h" + std::to_string(ia.hiddennodes)       +
-                 "o" + std::to_string(ia.outputnodes)       +
-                 "." + ia.test                              + 
-                 "output";
-      run(
-         makeNetwork(ia,
-                     seed,
-                     scheme),
-         ia, seed, fileName
-      );
+   for (uint64_t j = 0; j < catalogue.size(); j++) {
+      if (!Shard::owns(ia.shard, seedIndex * catalogue.size() + j)) { continue; }
+      Trace::Span span("job", "sweep", seed, static_cast<int64_t>(j));
+      const std::string scheme = catalogue.name(j);
+      catalogue.labels(j, labels);
+      fileName = resultFile(ia, scheme);
+      run(pool.acquire(seed, labels, scheme), ia, seed, fileName);
+      progress.finishJob();
    }
 }
 
-void updateStatusBar (const double percent) {
+double measureThroughput(const InputArgs& ia,
+                         const std::vector< Placement::Node >& nodes,
+                         const Placement::Mode mode,
+                         const uint32_t workers) {
    /*
-    * Update the progressbar by percent percent, then
-    * reprint it.
-    * This seems to currently print on multiple lines,
-    * but that might be platform specific.
+    * Train one network like those of the sweep on every worker,
+    * placed as given, in rounds of a fixed amount of epochs until
+    * at least half a second has passed. Returns the epochs per
+    * second of all workers together.
     */
-   progress += percent;
+   const uint64_t epochs = 1000;
+   const double minimum = 0.5;
+   uint64_t rounds = 0;
+   double seconds = 0.0;
+   const auto start = std::chrono::steady_clock::now();
+   while (seconds < minimum) {
+      std::vector< std::future< void > > threads(workers);
+      for (uint32_t w = 0; w < workers; w++) {
+         threads[w] = async(std::launch::async, [&ia, &nodes, mode, w, epochs] {
+            Placement::pin(nodes, mode, w);
+            Network n = makeNetwork(ia, ia.seed);
+            Tests tests;
+            vecdo inputVector;
+            vecdo expectedOutputs;
+            for (uint64_t e = 0; e < epochs; e++) {
+               tests.runSmallTest(inputVector, expectedOutputs, ia.test);
+               n.inputs(inputVector);
+               n.expectedOutputs(expectedOutputs);
+               n.train();
+            }
+         });
+      }
+      for (auto& thread : threads) { thread.get(); }
+      rounds++;
+      seconds = std::chrono::duration< double >(
+                   std::chrono::steady_clock::now() - start).count();
+   }
+   return rounds * workers * epochs / seconds;
+}
+
+// The seeds of the sweep
+const uint16_t startseed = 100, endseed = 1000, stepseed = 10;
 
-   const int barWidth = 70;
-   const auto amountProg = static_cast<unsigned long>(barWidth * progress);
+std::vector<uint16_t> sweepSeeds(const InputArgs& ia) {
+   // Every seed of the sweep, or just the given one
+   std::vector<uint16_t> seeds = {ia.seed};
+   if (ia.schemes) {
+      seeds.clear();
+      for (uint16_t s = startseed; s <= endseed; s += stepseed) {
+         seeds.push_back(s);
+      }
+   }
+   return seeds;
+}
 
-   std::cout << "[" << std::string(amountProg, '#')
-             << std::string(barWidth - amountProg, ' ') << "] "
-             << int(progress * 100.0) << "%\r";
-   std::cout.flush();
+std::string runAdaptive(const Catalogue& catalogue,
+                        const InputArgs& ia,
+                        const uint32_t workers,
+                        const std::vector< Placement::Node >& nodes) {
+   /*
+    * Train the schemes with as many seeds as it takes to tell the
+    * best ia.topSchemes apart from the rest, within a budget of
+    * ia.adaptiveBudget jobs. The allocator decides which scheme
+    * gets the next seed. A scheme takes the seeds of the sweep in
+    * order, and goes on past the last one if it needs more.
+    * Returns how much of the full sweep that took.
+    */
+   const uint64_t maxSeeds = (UINT16_MAX - startseed) / stepseed + 1;
+   Allocator allocator(catalogue.size(), ia.topSchemes, ia.adaptiveBudget, maxSeeds);
+   __attribute__((unused)) const auto unused =
+               static_cast<uint16_t>(system(("mkdir -p " +
+                                             ia.folder +
+                                             " 2> /dev/null").c_str()));
+   {
+      std::vector< std::future< void > > threads(workers);
+      for (uint32_t w = 0; w < workers; w++) {
+         threads[w] = async(std::launch::async, [&, w] {
+            Progress::worker(w);
+            Placement::pin(nodes, ia.placement, w);
+            Catalogue::Labels labels;
+            Dln::Pool pool(config(ia));
+            uint64_t j, seedIndex;
+            while (allocator.next(j, seedIndex)) {
+               const auto seed = static_cast<uint16_t>(startseed + seedIndex * stepseed);
+               Trace::Span span("job", "sweep", seed, static_cast<int64_t>(j));
+               const std::string scheme = catalogue.name(j);
+               catalogue.labels(j, labels);
+               run(pool.acquire(seed, labels, scheme),
+                   ia, seed, resultFile(ia, scheme), false, false,
+                   [&allocator, j](const double error) { allocator.record(j, error); });
+               progress.finishJob();
+            }
+         });
+      }
+      joinWorkers(threads);
+   }
+   const uint64_t full = catalogue.size() * ((endseed - startseed) / stepseed + 1);
+   std::ostringstream summary;
+   summary << std::fixed << std::setprecision(1)
+           << "Trained " << allocator.allocated() << " jobs, "
+           << 100.0 * allocator.allocated() / full << "% of the " << full
+           << " of a sweep of every scheme with every seed, "
+           << allocator.settled() << " of " << catalogue.size()
+           << " schemes are settled";
+   return summary.str();
+}
+
+void compareActivations(InputArgs ia) {
+   /*
+    * Train the same networks with every activation until their
+    * error is below the target, and print per activation how many
+    * of them got there, and the average amount of epochs and time
+    * this took. Networks which never get there count with all
+    * epochs and their full time. Every network sees the same
+    * training cases, as rand() is reseeded with its seed.
+    */
+   const std::vector<uint16_t> seeds = sweepSeeds(ia);
+   Tests tests;
+   printf("%-14s %8s %12s %12s %12s\n",
+          "activation", "reached", "epochs", "ms", "us/epoch");
+   for (uint32_t a = 0; a < Activation::AMOUNT; a++) {
+      ia.activation = static_cast<Activation::Type>(a);
+      uint64_t reached = 0, totalEpochs = 0;
+      double totalMs = 0.0;
+      for (const uint16_t seed : seeds) {
+         srand(seed);
+         Network n = makeNetwork(ia, seed);
+         Tests::TestParameters param(n, false, "", "a", true, seed);
+         vecdo inputVector;
+         vecdo expectedOutputs;
+         const auto started = std::chrono::steady_clock::now();
+         uint64_t epoch = 0;
+         for (; epoch < ia.epochs; epoch++) {
+            tests.runSmallTest(inputVector, expectedOutputs, ia.test);
+            n.inputs(inputVector);
+            n.expectedOutputs(expectedOutputs);
+            n.train();
+            if (n.diverged()) { epoch = ia.epochs; break; }
+            if (epoch % 10 == 0) {
+               param.network = n;
+               if (tests.runTest(param, ia.test, false) < ia.targetError) {
+                  reached++;
+                  epoch++;
+                  break;
+               }
+            }
+         }
+         totalEpochs += epoch;
+         totalMs += std::chrono::duration< double, std::milli >(
+                       std::chrono::steady_clock::now() - started).count();
+      }
+      printf("%-14s %4llu/%-3llu %12.1f %12.3f %12.3f\n",
+             Activation::name(ia.activation).c_str(),
+             static_cast<unsigned long long>(reached),
+             static_cast<unsigned long long>(seeds.size()),
+             static_cast<double>(totalEpochs) / seeds.size(),
+             totalMs / seeds.size(),
+             totalEpochs > 0 ? 1000.0 * totalMs / totalEpochs : 0.0);
+   }
+}
+
+void measureScaling(const InputArgs& ia) {
+   /*
+    * Time trainBatch() on one network of the given topology with
+    * a doubling amount of threads, up to ia.trainThreads, and
+    * print the cases per second, the speedup over one thread and
+    * the efficiency: the speedup per thread. Every amount trains
+    * the same cases, for at least half a second, after a round to
+    * start the threads and warm up the caches.
+    */
+   const double minimum = 0.5;
+   const size_t batch = std::max< size_t >(ia.batchSize, ia.trainThreads);
+   Tests tests;
+   srand(ia.seed);
+   vecvecdo inputs(batch);
+   vecvecdo expected(batch);
+   for (size_t c = 0; c < batch; c++) {
+      tests.runSmallTest(inputs[c], expected[c], ia.test);
+   }
+   std::vector< unsigned int > amounts;
+   for (unsigned int t = 1; t < ia.trainThreads; t *= 2) { amounts.push_back(t); }
+   amounts.push_back(ia.trainThreads);
+   
+   fprintf(stderr, "Training %u hidden layers of %u nodes on batches of %zu %s "
+                   "cases, %s, on %u cores.\n",
+           ia.layers, ia.hiddennodes - 1, batch, ia.test.c_str(),
+           ia.parallel == Network::HOGWILD ? "hogwild" : "deterministic",
+           std::thread::hardware_concurrency());
+   printf("%8s %14s %10s %12s\n", "threads", "cases/s", "speedup", "efficiency");
+   double single = 0.0;
+   for (const unsigned int threads : amounts) {
+      Network n = makeNetwork(ia, ia.seed);
+      n.trainBatch(inputs, expected, threads, ia.parallel);
+      uint64_t steps = 0;
+      double seconds = 0.0;
+      const auto start = std::chrono::steady_clock::now();
+      while (seconds < minimum) {
+         n.trainBatch(inputs, expected, threads, ia.parallel);
+         steps++;
+         seconds = std::chrono::duration< double >(
+                      std::chrono::steady_clock::now() - start).count();
+      }
+      const double rate = steps * batch / seconds;
+      if (threads == 1) { single = rate; }
+      printf("%8u %14.0f %9.2fx %11.1f%%\n",
+             threads, rate, rate / single, 100.0 * rate / single / threads);
+   }
+}
+
+void compareWarmStart(const InputArgs& ia) {
+   /*
+    * Train every scheme twice per seed, until its error is below
+    * the target: once from its own initial weights (cold), and once
+    * along the lattice of schemes (warm). Merging two neighbouring
+    * groups of a scheme gives a coarser one, its child. The finest
+    * scheme is trained cold, every other scheme starts from the
+    * weights of its best trained parent, averaged over its own
+    * groups, and gets ia.warmEpochs epochs. In the catalogue the
+    * parents of scheme s are s with one more boundary bit set, so
+    * the schemes are trained from the most groups to the fewest.
+    * Prints per start how many reached the target and how long
+    * that took.
+    */
+   const uint64_t length = amountWeights(ia);
+   Catalogue catalogue;
+   try {
+      catalogue = Catalogue::generate(length);
+   } catch (std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return;
+   }
+   const double target = ia.targetError > 0.0 ? ia.targetError : 0.1;
+   std::vector< uint64_t > order(catalogue.size());
+   for (uint64_t s = 0; s < order.size(); s++) { order[s] = s; }
+   std::stable_sort(order.begin(), order.end(), [](const uint64_t a, const uint64_t b) {
+      return __builtin_popcountll(a) > __builtin_popcountll(b);
+   });
+   
+   struct Outcome {
+      bool reached = false;
+      uint64_t epochs = 0;
+      double ms = 0.0;
+      double error = HUGE_VAL;
+   };
+   struct Totals {
+      uint64_t runs = 0, reached = 0, epochs = 0, diverged = 0;
+      double ms = 0.0, error = 0.0;
+      void add(const Outcome& o) {
+         runs++;
+         reached += o.reached;
+         epochs += o.epochs;
+         ms += o.ms;
+         if (std::isfinite(o.error)) { error += o.error; } else { diverged++; }
+      }
+   };
+   Tests tests;
+   const auto train = [&](Network& n, const uint16_t seed, const uint64_t epochs) {
+      Outcome o;
+      srand(seed);
+      Tests::TestParameters param(n, false, "", "a", true, seed);
+      vecdo inputVector;
+      vecdo expectedOutputs;
+      const auto started = std::chrono::steady_clock::now();
+      for (; o.epochs < epochs; o.epochs++) {
+         n.alpha(ia.schedule.alpha(ia.alpha, o.epochs, epochs));
+         tests.runSmallTest(inputVector, expectedOutputs, ia.test);
+         n.inputs(inputVector);
+         n.expectedOutputs(expectedOutputs);
+         n.train();
+         if (n.diverged()) { break; }
+         if (o.epochs % 10 == 0) {
+            param.network = n;
+            if (tests.runTest(param, ia.test, false) < target) {
+               o.reached = true;
+               o.epochs++;
+               break;
+            }
+         }
+      }
+      o.ms = std::chrono::duration< double, std::milli >(
+                std::chrono::steady_clock::now() - started).count();
+      if (!n.diverged()) {
+         param.network = n;
+         o.error = tests.runTest(param, ia.test, false);
+      }
+      return o;
+   };
+   
+   Totals cold, warm;
+   const uint64_t full = catalogue.size() - 1;
+   Catalogue::Labels labels;
+   for (const uint16_t seed : sweepSeeds(ia)) {
+      // The trained networks of the lattice, only the level above
+      // the current one is needed
+      std::map< uint64_t, std::pair< Network, double > > above, level;
+      int levelBits = -1;
+      for (const uint64_t s : order) {
+         if (__builtin_popcountll(s) != levelBits) {
+            above = std::move(level);
+            level.clear();
+            levelBits = __builtin_popcountll(s);
+         }
+         catalogue.labels(s, labels);
+         const std::string scheme = catalogue.name(s);
+         Network n = makeNetwork(ia, seed, labels, scheme);
+         Network w = n;
+         const Outcome c = train(n, seed, ia.epochs);
+         cold.add(c);
+         
+         const std::pair< Network, double > *parent = nullptr;
+         for (uint64_t bit = 1; bit <= full; bit <<= 1) {
+            const auto p = above.find(s | bit);
+            if ((s & bit) || p == above.end() || !std::isfinite(p->second.second)) {
+               continue;
+            }
+            if (parent == nullptr || p->second.second < parent->second) {
+               parent = &p->second;
+            }
+         }
+         if (parent == nullptr) {
+            // The top of the lattice, or all its parents diverged
+            warm.add(c);
+            level.emplace(s, std::make_pair(n, c.error));
+            continue;
+         }
+         vecdo weights = parent->first.schemeWeights();
+         Dln::tie(weights, labels, 1.0);
+         w.initialiseWeights(0, weights);
+         const Outcome o = train(w, seed, ia.warmEpochs);
+         warm.add(o);
+         level.emplace(s, std::make_pair(w, o.error));
+      }
+   }
+   
+   printf("%-6s %12s %12s %12s %12s %10s\n",
+          "start", "reached", "epochs", "ms", "error", "diverged");
+   const auto print = [](const char *name, const Totals& t) {
+      printf("%-6s %5llu/%-6llu %12.1f %12.3f %12f %10llu\n", name,
+             static_cast<unsigned long long>(t.reached),
+             static_cast<unsigned long long>(t.runs),
+             static_cast<double>(t.epochs) / t.runs, t.ms / t.runs,
+             t.runs > t.diverged ? t.error / (t.runs - t.diverged) : 0.0,
+             static_cast<unsigned long long>(t.diverged));
+   };
+   print("cold", cold);
+   print("warm", warm);
+   fprintf(stderr, "Warm starts took %.1f%% of the epochs and %.1f%% of the time "
+                   "of cold starts for %llu schemes.\n",
+           cold.epochs > 0 ? 100.0 * warm.epochs / cold.epochs : 0.0,
+           cold.ms > 0.0 ? 100.0 * warm.ms / cold.ms : 0.0,
+           static_cast<unsigned long long>(catalogue.size()));
+}
+
+void searchSchemes(const InputArgs& ia) {
+   /*
+    * Search for the schemes of this topology with the lowest error
+    * after ia.epochs epochs, training at most ia.searchBudget of
+    * them, and print the best ones. Every scheme is trained with
+    * the same seed and sees the same training cases, as rand() is
+    * reseeded before each, so the errors can be compared.
+    */
+   const uint64_t length = amountWeights(ia);
+   const Dln::Config c = config(ia);
+   const Search::Fitness fitness = [&ia, &c](const Catalogue::Labels& labels) {
+      srand(ia.seed);
+      Network n = Dln::build(c, ia.seed, labels, Catalogue::name(labels));
+      Dln::train(n, c, ia.epochs);
+      return Dln::evaluate(n, ia.test);
+   };
+   
+   // Temperatures in units of the error, which changes by a few
+   // hundredths between neighbouring schemes
+   const double hot = 0.1, cold = 0.001;
+   const auto start = std::chrono::steady_clock::now();
+   Search search(length, fitness, ia.seed);
+   search.anneal(ia.searchBudget, hot, cold);
+   const double seconds = std::chrono::duration< double >(
+                             std::chrono::steady_clock::now() - start).count();
+   
+   printf("%-6s %-*s %12s\n", "rank", static_cast<int>(std::max< uint64_t >(length, 6)),
+          "scheme", "error");
+   uint32_t rank = 1;
+   for (const Search::Result& r : search.best(10)) {
+      printf("%-6u %-*s %12f\n", rank++,
+             static_cast<int>(std::max< uint64_t >(length, 6)),
+             Catalogue::name(r.labels).c_str(), r.error);
+   }
+   const double all = Search::partitions(length);
+   fprintf(stderr, "Trained %llu of %.4g schemes (%.3g%%) in %llu steps, "
+                   "%llu of which went to a scheme trained before, in %.1f s.\n",
+           static_cast<unsigned long long>(search.trained()), all,
+           100.0 * search.trained() / all,
+           static_cast<unsigned long long>(search.steps()),
+           static_cast<unsigned long long>(search.remembered()), seconds);
+}
+
+int runSweep(InputArgs ia) {
+   /*
+    * Run every configuration of the sweep spec in this process.
+    * Configurations with the same amount of weights share one
+    * catalogue of schemes. All (configuration, seed, scheme) jobs
+    * go to one pool of workers, which take the next job as soon as
+    * they are done. The configurations with the most work per job
+    * come first, so no long jobs are left trailing at the end.
+    * All results go to a single results store.
+    */
+   Sweep::Spec spec;
+   spec.tests  = {ia.test};
+   spec.layers = {ia.layers};
+   spec.hidden = {ia.hiddennodes - 1};
+   spec.alphas = {ia.alpha};
+   spec.epochs = {ia.epochs};
+   spec.seeds  = sweepSeeds(ia);
+   if (!Sweep::parse(ia.sweepFile, spec)) { return 1; }
+   
+   std::map< uint64_t, Catalogue > catalogues;
+   std::vector< InputArgs > configs;
+   for (const Sweep::Config& c : Sweep::expand(spec)) {
+      InputArgs config = ia;
+      config.test = c.test;
+      config.layers = c.layers;
+      config.hiddennodes = c.hidden + 1;
+      config.alpha = c.alpha;
+      config.epochs = c.epochs;
+      testNodes(config);
+      if (!singleOutput(config)) { return 1; }
+      const uint64_t length = ia.randomWeights ? 0 : amountWeights(config);
+      if (catalogues.find(length) == catalogues.end()) {
+         try {
+            catalogues.emplace(length, ia.catalogueFile.empty() ?
+                               Catalogue::generate(length) :
+                               Catalogue::cached(ia.catalogueFile + "." +
+                                                 std::to_string(length), length));
+         } catch (std::exception& e) {
+            fprintf(stderr, "%s: %s\n", Sweep::describe(c).c_str(), e.what());
+            return 1;
+         }
+      }
+      configs.push_back(config);
+   }
+   const auto catalogueOf = [&](const InputArgs& config) -> const Catalogue& {
+      return catalogues.at(ia.randomWeights ? 0 : amountWeights(config));
+   };
+   std::stable_sort(configs.begin(), configs.end(),
+                    [&](const InputArgs& a, const InputArgs& b) {
+      return a.epochs * amountWeights(a) > b.epochs * amountWeights(b);
+   });
+   
+   // The number of the first job of every configuration
+   std::vector< uint64_t > firstJobs;
+   uint64_t totalJobs = 0, totalEpochs = 0;
+   for (const InputArgs& config : configs) {
+      const uint64_t jobs = spec.seeds.size() * catalogueOf(config).size();
+      firstJobs.push_back(totalJobs);
+      totalJobs += jobs;
+      totalEpochs += jobs * config.epochs;
+      fprintf(stderr, "%s: %zu seeds x %llu schemes\n",
+              Sweep::describe({config.test, config.layers, config.hiddennodes - 1,
+                               config.alpha, config.epochs}).c_str(),
+              spec.seeds.size(),
+              static_cast<unsigned long long>(catalogueOf(config).size()));
+   }
+   if (totalJobs == 0) { return 0; }
+   
+   __attribute__((unused)) const auto unused =
+               static_cast<uint16_t>(system(("mkdir -p " +
+                                             ia.folder +
+                                             " 2> /dev/null").c_str()));
+   const std::string store = ia.folder + "sweep.results";
+   if (!results.open(ia.toFile ? store : "", resultColumns)) { return 1; }
+   if (!ia.traceFile.empty()) { Trace::enable(ia.traceFile); }
+   
+   const uint32_t workers = std::max(1u, std::thread::hardware_concurrency());
+   const std::vector< Placement::Node > nodes =
+      ia.placement != Placement::NONE ? Placement::topology() :
+                                        std::vector< Placement::Node >();
+   progress.start(workers, totalJobs, totalEpochs / totalJobs);
+   progress.report(ia.toFile, ia.metricsFile, ia.metricsInterval);
+   evaluator.start((workers + 7) / 8, ia.evalQueue);
+   evaluator.results(&results);
+   
+   std::atomic< uint64_t > nextJob(0);
+   {
+      std::vector< std::future< void > > threads(workers);
+      for (uint32_t w = 0; w < workers; w++) {
+         threads[w] = async(std::launch::async, [&, w] {
+            Progress::worker(w);
+            Placement::pin(nodes, ia.placement, w);
+            Catalogue::Labels labels;
+            // A pool per configuration, made when first needed
+            std::vector< std::unique_ptr< Dln::Pool > > pools(configs.size());
+            uint64_t job;
+            while ((job = nextJob.fetch_add(1)) < totalJobs) {
+               const size_t c = static_cast<size_t>(
+                  std::upper_bound(firstJobs.begin(), firstJobs.end(), job) -
+                  firstJobs.begin() - 1);
+               const InputArgs& config = configs[c];
+               const Catalogue& catalogue = catalogueOf(config);
+               const uint64_t local = job - firstJobs[c];
+               const uint16_t seed = spec.seeds[local / catalogue.size()];
+               const uint64_t j = local % catalogue.size();
+               Trace::Span span("job", "sweep", seed, static_cast<int64_t>(j));
+               const std::string scheme = catalogue.name(j);
+               catalogue.labels(j, labels);
+               if (!pools[c]) { pools[c].reset(new Dln::Pool(::config(config))); }
+               run(pools[c]->acquire(seed, labels, scheme),
+                   config, seed, resultFile(config, scheme));
+               progress.finishJob();
+            }
+         });
+      }
+      joinWorkers(threads);
+   }
+   
+   evaluator.stop();
+   evaluator.results(nullptr);
+   results.close();
+   progress.stop();
+   Trace::write();
+   fprintf(stderr, "\nSwept %zu configurations with %zu catalogues on %u "
+                   "workers, %llu results in %s.\n",
+           configs.size(), catalogues.size(), workers,
+           static_cast<unsigned long long>(results.rows()),
+           ia.toFile ? store.c_str() : "the terminal");
+   reportValidations();
+   if (cache.enabled()) { fprintf(stderr, "%s.\n", cache.describe().c_str()); }
+   return workerFailed ? 1 : 0;
 }
 
 void usage(const std::string& programName) {
-   printf("Usage: %s [-s] [-lneadrtcf]() [-h]\n", programName.c_str());
+   printf("Usage: %s [-s] [-lneadrtcfmpTSLMzokwbjqA]() [-h]\n", programName.c_str());
    const char* toPrint = R"(
    Option <input>: What it does (default value).
    
@@ -333,13 +1040,209 @@ void usage(const std::string& programName) {
    -d <integer>  : The seed of the network (1230).
    -r <integer>  : The seed to shuffle the scheme with. 0 means no shuffle,
                    1 means reverse, higher values are fed to an rng (0).
-   -t <string>   : The test to be run (xor).
+   -t <string>   : The test to be run: xor, abc, or gates, which trains one
+                   network with an output each for the xor, and and or of
+                   its inputs. -q, --save-model, --load-model and
+                   --validate need a single output (xor).
    -c            : If given, the program prints to the commandline instead
                    of to files (off).
    -f <string>   : The name of the folder to store the results in (output/).
+   -m <string>   : Periodically write a snapshot of the progress and
+                   throughput metrics to this file (off).
+   -p <integer>  : The amount of seconds between two metrics snapshots (5).
+   -T <string>   : Record a timeline of the jobs on each thread and write it
+                   to this file as Chrome trace-event JSON (off).
+   -S, --shard <i/N>
+                 : Only run shard i of N of the (seed, scheme) jobs, writing
+                   to its own folder inside the results folder (off).
+   -L, --launch <integer>
+                 : Split the sweep into this many shards and run each one as
+                   a separate process. Shards which are already done are
+                   skipped, so this also retries failed shards (off).
+   -M, --merge <integer>
+                 : Merge the results of this many finished shards into the
+                   results folder (off).
+   -z            : Safe numerics: flush denormals to zero instead of trapping
+                   underflow, and abandon runs which diverge to NaN instead
+                   of crashing on them (off).
+   -o, --optimizer <string>
+                 : How the weights are updated: sgd, momentum, nesterov
+                   or adam (sgd).
+   --momentum <double>
+                 : The momentum of momentum and nesterov, or beta1 of
+                   adam (0.9).
+   -k, --schedule <string>
+                 : How alpha changes over the epochs: constant, step or
+                   cosine (constant).
+   --step-size <integer>
+                 : The amount of epochs between two steps of the step
+                   schedule (a quarter of the epochs).
+   --step-gamma <double>
+                 : What alpha is multiplied with at every step (0.5).
+   --warmup <integer>
+                 : The amount of epochs over which alpha is increased
+                   linearly from 0 at the start (0).
+   --target <double>
+                 : Stop training once the error is below this value, and
+                   report how long it took (off).
+   -w            : Train a single network with random weights instead of
+                   one network per scheme (off).
+   -b <integer>  : The amount of cases in each training step (1).
+   -j <integer>  : The amount of threads a training step is split over,
+                   when the batch has more than one case (1).
+   --parallel <string>
+                 : How these threads combine their work: deterministic sums
+                   their directions in a fixed order, hogwild lets them
+                   update the weights without locking, with -o sgd only
+                   (deterministic).
+   --prune <double>
+                 : Prune the network: weights closer to 0 than this are set
+                   to 0 and stay 0. The effect is reported in a file with
+                   "pruned" in its name (off).
+   --prune-at <integers>
+                 : Comma separated epochs at which to prune (half of the
+                   epochs).
+   --sparse-cutoff <double>
+                 : Layers with a smaller fraction of weights left than this
+                   use sparse kernels (0.5).
+   -q            : After training, compare an int8 version of the network
+                   with it, and report the deviation, speedup and memory in
+                   a file with "quantised" in its name (off).
+   --save-model  : Save every trained network as a binary model, next to
+                   its results with d<seed>.model as extension (off).
+   --load-model <string>
+                 : Map this model file, run the cases of the test on it
+                   and print the results, instead of training (off).
+   --catalogue <string>
+                 : Keep the catalogue of schemes in this file. It is mapped
+                   when it holds schemes of the right length, else it is
+                   generated and saved there (off).
+   --pin <string>: Pin every worker to a NUMA node from /sys: to one core
+                   of it (core), to all of its cores (node), or not at all
+                   (none). The throughput of a short run with and without
+                   pinning is reported first (none).
+   -A, --activation <string>
+                 : The activation of the hidden nodes: sigmoid, tanh, relu
+                   or hard-sigmoid (sigmoid).
+   --compare-activations
+                 : Instead of the sweep, train the networks of the seeds
+                   with every activation until the error is below the
+                   --target, and compare the epochs and time it took.
+                   Implies -z (off).
+   --scaling     : Instead of the sweep, time training steps of one network
+                   with 1, 2, 4, ... up to -j threads, and print how the
+                   cases per second scale. The batch is -b cases, at least
+                   one per thread (off).
+   --eval-queue <integer>
+                 : The amount of checkpoint snapshots which may wait to be
+                   tested, by one thread per 8 workers, while training goes
+                   on. 0 tests them on the workers themselves (64).
+   --sweep <string>
+                 : Sweep every configuration of this spec file in one run,
+                   the largest first, over one pool of workers. See
+                   Sweep.hpp for the format. All results go to the file
+                   sweep.results in the output folder (off).
+   --cache <string>
+                 : Keep the results of every job in this folder, and take
+                   them from there instead of training when the same job
+                   comes again. Not used for jobs with -q, --save-model
+                   or --prune (off).
+   --search <integer>
+                 : Instead of training every scheme of the sweep, search
+                   for the schemes with the lowest error after -e epochs
+                   by simulated annealing over all ways to group the
+                   weights, training at most this many schemes, and print
+                   the best ones. Use few epochs (off).
+   --no-dumps    : Only test the networks at the end of training, for the
+                   statistics of the schemes, instead of writing the error
+                   of every checkpoint to the result files (off).
+   --top <integer>
+                 : The amount of best and worst schemes to list first in
+                   schemes.summary, which has the mean, spread, minimum and
+                   maximum of the final error of every scheme over the
+                   seeds (10).
+   --adaptive <integer>
+                 : Instead of training every scheme with every seed, give
+                   each scheme 5 seeds and then the next seeds to the
+                   schemes of which it is not yet clear whether they are
+                   among the --top best, until that is clear for all of
+                   them or this many jobs have been trained (off).
+   --warm-start <integer>
+                 : Compare training every scheme from scratch for -e epochs
+                   with training the schemes from the finest to the
+                   coarsest, each starting from the averaged weights of its
+                   best trained parent for this many epochs. Both stop at
+                   --target (or 0.1), and the time that took is printed
+                   (off).
+   --validate <integer>
+                 : Also check every trained network on this many held-out
+                   cases, generated like the training cases but the same
+                   for every network, split over the -j threads. The mean
+                   squared and absolute error, the accuracy per outcome
+                   and the cost relative to training are written to a file
+                   with "validation" in its name (off).
    -h            : Print this help message (off).
    )";
    printf("%s\n", toPrint);
+   printf("Or: %s infer [-b <integer>] [-j <integer>] <model> [<file>]\n", programName.c_str());
+   const char* toPrintInfer = R"(
+   Predict a case per line of file (or of the standard input) with a
+   model saved by --save-model, and write the predictions in order.
+   
+   -b <integer>  : The amount of cases in a batch (4096).
+   -j <integer>  : The amount of threads computing the batches (all cores).
+   )";
+   printf("%s\n", toPrintInfer);
+}
+
+int runInfer(const int argc, char **argv) {
+   /*
+    * The infer command, argv[0] is "infer". Reports the throughput
+    * and the latency of the batches afterwards.
+    */
+   size_t batchSize = 4096;
+   unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+   int option;
+   optind = 1;
+   while ((option = getopt(argc, argv, "b:j:h")) != -1) {
+      switch (option) {
+         case 'b':
+            batchSize = static_cast<size_t>(std::max(1, std::atoi(optarg)));
+            break;
+         case 'j':
+            threads = static_cast<unsigned int>(std::max(1, std::atoi(optarg)));
+            break;
+         default:
+            fprintf(stderr, "Usage: dln infer [-b <integer>] [-j <integer>] "
+                            "<model> [<file>]\n");
+            return option == 'h' ? 0 : 1;
+      }
+   }
+   if (optind >= argc) {
+      fprintf(stderr, "No model given to infer with!\n");
+      return 1;
+   }
+   const Model::Mapped model(argv[optind]);
+   if (!model.valid()) { return 1; }
+   FILE *in = stdin;
+   if (optind + 1 < argc && std::string(argv[optind + 1]) != "-") {
+      in = fopen(argv[optind + 1], "r");
+      if (in == nullptr) {
+         fprintf(stderr, "Could not read %s!\n", argv[optind + 1]);
+         return 1;
+      }
+   }
+   Infer::Report report;
+   const bool valid = Infer::stream(model, in, stdout, batchSize, threads, report);
+   if (in != stdin) { fclose(in); }
+   fprintf(stderr, "Predicted %llu cases in %llu batches of at most %zu on %u threads "
+                   "in %.3f s: %.0f cases/s.\n"
+                   "Batch latency p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms.\n",
+           static_cast<unsigned long long>(report.cases),
+           static_cast<unsigned long long>(report.batches), batchSize, threads,
+           report.seconds, report.seconds > 0.0 ? report.cases / report.seconds : 0.0,
+           report.p50, report.p90, report.p99, report.max);
+   return valid ? 0 : 1;
 }
 
 InputArgs parseArgs(const int argc, char **argv) {
@@ -360,18 +1263,97 @@ InputArgs parseArgs(const int argc, char **argv) {
    ia.test = "xor";
    ia.toFile = true;
    ia.folder = "output/";
+   ia.traceFile = "";
+   ia.metricsFile = "";
+   ia.metricsInterval = 5;
+   ia.shard = {0, 0};
+   ia.launchShards = 0;
+   ia.mergeShards = 0;
+   ia.safeNumerics = false;
+   ia.optimizer = Optimizer(Optimizer::SGD);
+   ia.schedule = Schedule(Schedule::CONSTANT);
+   ia.targetError = 0.0;
+   ia.randomWeights = false;
+   ia.batchSize = 1;
+   ia.trainThreads = 1;
+   ia.parallel = Network::DETERMINISTIC;
+   ia.pruneThreshold = 0.0;
+   ia.pruneEpochs = {};
+   ia.sparseCutoff = 0.5;
+   ia.quantise = false;
+   ia.saveModel = false;
+   ia.loadModel = "";
+   ia.catalogueFile = "";
+   ia.placement = Placement::NONE;
+   ia.activation = Activation::SIGMOID;
+   ia.compareActivations = false;
+   ia.scaling = false;
+   ia.evalQueue = 64;
+   ia.sweepFile = "";
+   ia.cacheFolder = "";
+   ia.searchBudget = 0;
+   ia.dumps = true;
+   ia.topSchemes = 10;
+   ia.adaptiveBudget = 0;
+   ia.warmEpochs = 0;
+   ia.validateCases = 0;
    
-   while ((c = getopt (argc, argv, "sl:n:e:a:d:r:t:cf:")) != -1) {
+   // Options without a short version
+   enum { MOMENTUM = 256, STEPSIZE, STEPGAMMA, WARMUP, TARGET, PARALLEL,
+          PRUNE, PRUNEAT, SPARSECUTOFF, SAVEMODEL, LOADMODEL,
+          CATALOGUE, PIN, COMPAREACTIVATIONS, EVALQUEUE, SWEEP, CACHE,
+          SEARCH, NODUMPS, TOP, ADAPTIVE, WARMSTART, VALIDATE, SCALING };
+   const struct option longOptions[] = {
+      {"shard",      required_argument, nullptr, 'S'},
+      {"launch",     required_argument, nullptr, 'L'},
+      {"merge",      required_argument, nullptr, 'M'},
+      {"optimizer",  required_argument, nullptr, 'o'},
+      {"schedule",   required_argument, nullptr, 'k'},
+      {"momentum",   required_argument, nullptr, MOMENTUM},
+      {"step-size",  required_argument, nullptr, STEPSIZE},
+      {"step-gamma", required_argument, nullptr, STEPGAMMA},
+      {"warmup",     required_argument, nullptr, WARMUP},
+      {"target",     required_argument, nullptr, TARGET},
+      {"parallel",   required_argument, nullptr, PARALLEL},
+      {"prune",      required_argument, nullptr, PRUNE},
+      {"prune-at",   required_argument, nullptr, PRUNEAT},
+      {"sparse-cutoff", required_argument, nullptr, SPARSECUTOFF},
+      {"save-model", no_argument,       nullptr, SAVEMODEL},
+      {"load-model", required_argument, nullptr, LOADMODEL},
+      {"catalogue",  required_argument, nullptr, CATALOGUE},
+      {"pin",        required_argument, nullptr, PIN},
+      {"activation", required_argument, nullptr, 'A'},
+      {"compare-activations", no_argument, nullptr, COMPAREACTIVATIONS},
+      {"eval-queue", required_argument, nullptr, EVALQUEUE},
+      {"sweep",      required_argument, nullptr, SWEEP},
+      {"cache",      required_argument, nullptr, CACHE},
+      {"search",     required_argument, nullptr, SEARCH},
+      {"no-dumps",   no_argument,       nullptr, NODUMPS},
+      {"top",        required_argument, nullptr, TOP},
+      {"adaptive",   required_argument, nullptr, ADAPTIVE},
+      {"warm-start", required_argument, nullptr, WARMSTART},
+      {"validate",   required_argument, nullptr, VALIDATE},
+      {"scaling",    no_argument,       nullptr, SCALING},
+      {nullptr,      0,                 nullptr, 0}
+   };
+   Optimizer::Type optimizerType = Optimizer::SGD;
+   Schedule::Type scheduleType = Schedule::CONSTANT;
+   double momentum = 0.9;
+   uint64_t stepSize = 0, warmup = 0;
+   double stepGamma = 0.5;
+   
+   while ((c = getopt_long (argc, argv, "sl:n:e:a:d:r:t:cf:m:p:T:S:L:M:zo:k:wb:j:qA:",
+                            longOptions, nullptr)) != -1) {
       switch (c) {
          case 's':
             ia.schemes = true;
             break;
          case 'l':
-            if (optarg) { ia.layers = static_cast<uint8_t>(
+            if (optarg) { ia.layers = static_cast<uint32_t>(
                                         std::atoi(optarg)); }
             break;
          case 'n':
-            if (optarg) { ia.hiddennodes  = static_cast<uint8_t>(
+            if (optarg) { ia.hiddennodes  = static_cast<uint32_t>(
                     std::atoi(optarg)) + 1; }
             break;
          case 'e':
@@ -397,6 +1379,162 @@ InputArgs parseArgs(const int argc, char **argv) {
          case 'f':
             if (optarg) { ia.folder = optarg; }
             break;
+         case 'm':
+            if (optarg) { ia.metricsFile = optarg; }
+            break;
+         case 'p':
+            if (optarg) { ia.metricsInterval = static_cast<unsigned int>(
+                                                 std::atoi(optarg)); }
+            break;
+         case 'T':
+            if (optarg) { ia.traceFile = optarg; }
+            break;
+         case 'S':
+            if (optarg && !Shard::parse(optarg, ia.shard)) {
+               printf("Invalid shard %s, expected i/N!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case 'o':
+            if (optarg && !Optimizer::parse(optarg, optimizerType)) {
+               printf("Unknown optimizer %s!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case 'k':
+            if (optarg && !Schedule::parse(optarg, scheduleType)) {
+               printf("Unknown schedule %s!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case MOMENTUM:
+            if (optarg) { momentum = std::atof(optarg); }
+            break;
+         case STEPSIZE:
+            if (optarg) { stepSize = static_cast<uint64_t>(std::atol(optarg)); }
+            break;
+         case STEPGAMMA:
+            if (optarg) { stepGamma = std::atof(optarg); }
+            break;
+         case WARMUP:
+            if (optarg) { warmup = static_cast<uint64_t>(std::atol(optarg)); }
+            break;
+         case TARGET:
+            if (optarg) { ia.targetError = std::atof(optarg); }
+            break;
+         case 'w':
+            ia.randomWeights = true;
+            break;
+         case 'b':
+            if (optarg) { ia.batchSize = std::max(1, std::atoi(optarg)); }
+            break;
+         case 'j':
+            if (optarg) { ia.trainThreads = std::max(1, std::atoi(optarg)); }
+            break;
+         case PARALLEL:
+            if (optarg && std::string(optarg) == "hogwild") {
+               ia.parallel = Network::HOGWILD;
+            } else if (optarg && std::string(optarg) != "deterministic") {
+               printf("Unknown parallel mode %s!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case PRUNE:
+            if (optarg) { ia.pruneThreshold = std::atof(optarg); }
+            break;
+         case PRUNEAT:
+            if (optarg) {
+               std::istringstream epochs(optarg);
+               std::string epoch;
+               while (std::getline(epochs, epoch, ',')) {
+                  ia.pruneEpochs.insert(static_cast<uint64_t>(
+                                           std::atol(epoch.c_str())));
+               }
+            }
+            break;
+         case SPARSECUTOFF:
+            if (optarg) { ia.sparseCutoff = std::atof(optarg); }
+            break;
+         case 'q':
+            ia.quantise = true;
+            break;
+         case SAVEMODEL:
+            ia.saveModel = true;
+            break;
+         case LOADMODEL:
+            if (optarg) { ia.loadModel = optarg; }
+            break;
+         case CATALOGUE:
+            if (optarg) { ia.catalogueFile = optarg; }
+            break;
+         case 'A':
+            if (optarg && !Activation::parse(optarg, ia.activation)) {
+               printf("Unknown activation %s!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case COMPAREACTIVATIONS:
+            ia.compareActivations = true;
+            // ReLU can grow without bounds, so do not trap on overflow
+            ia.safeNumerics = true;
+            break;
+         case SCALING:
+            ia.scaling = true;
+            break;
+         case PIN:
+            if (optarg && !Placement::parse(optarg, ia.placement)) {
+               printf("Unknown placement %s!\n", optarg);
+               usage(argv[0]);
+               throw("");
+            }
+            break;
+         case EVALQUEUE:
+            if (optarg) { ia.evalQueue = static_cast<uint32_t>(
+                                           std::atoi(optarg)); }
+            break;
+         case SWEEP:
+            if (optarg) { ia.sweepFile = optarg; }
+            break;
+         case CACHE:
+            if (optarg) { ia.cacheFolder = optarg; }
+            break;
+         case SEARCH:
+            if (optarg) { ia.searchBudget = static_cast<uint64_t>(
+                                              std::atol(optarg)); }
+            break;
+         case NODUMPS:
+            ia.dumps = false;
+            break;
+         case TOP:
+            if (optarg) { ia.topSchemes = static_cast<size_t>(std::atol(optarg)); }
+            break;
+         case WARMSTART:
+            if (optarg) { ia.warmEpochs = static_cast<uint64_t>(
+                                            std::atol(optarg)); }
+            break;
+         case ADAPTIVE:
+            if (optarg) { ia.adaptiveBudget = static_cast<uint64_t>(
+                                                std::atol(optarg)); }
+            break;
+         case VALIDATE:
+            if (optarg) { ia.validateCases = static_cast<size_t>(std::atol(optarg)); }
+            break;
+         case 'z':
+            ia.safeNumerics = true;
+            break;
+         case 'L':
+            if (optarg) { ia.launchShards = static_cast<uint32_t>(
+                                              std::atoi(optarg)); }
+            break;
+         case 'M':
+            if (optarg) { ia.mergeShards = static_cast<uint32_t>(
+                                             std::atoi(optarg)); }
+            break;
          case 'h':
             usage(argv[0]);
             exit(0);
@@ -407,24 +1545,37 @@ InputArgs parseArgs(const int argc, char **argv) {
       }
     }
     
-    // There may be a better way, but this works
-    // + 1 is to indicate the bias node.
-    if (ia.test == "xor") {
-       ia.inputnodes = 2 + 1;
-       ia.outputnodes = 1;
+    if (ia.quantise && !QuantisedNetwork::supports(ia.activation)) {
+       printf("Only networks with a sigmoid or hard-sigmoid activation can "
+              "be quantised!\n");
+       throw("");
+    }
+    if (ia.compareActivations && ia.targetError <= 0.0) {
+       printf("--compare-activations needs a --target error!\n");
+       throw("");
     }
-    if (ia.test == "abc") {
-       ia.inputnodes = 3 + 1;
-       ia.outputnodes = 1;
+    if (ia.parallel == Network::HOGWILD && optimizerType != Optimizer::SGD) {
+       fprintf(stderr, "--parallel hogwild only works with the sgd optimizer, the "
+                       "others keep state per weight which the threads would "
+                       "share!\n");
+       throw("");
     }
+    if (ia.pruneThreshold > 0.0 && ia.pruneEpochs.empty()) {
+       ia.pruneEpochs.insert(ia.epochs / 2);
+    }
+    ia.optimizer = Optimizer(optimizerType, momentum);
+    ia.schedule = Schedule(scheduleType, warmup, stepSize, stepGamma);
+    
+    testNodes(ia);
     
     return ia;
 }
 
 int main (const int argc, char **argv) {
-   // Raise an error when one of these float exceptions occur.
-   feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW | FE_UNDERFLOW);
-
+   if (argc > 1 && std::string(argv[1]) == "infer") {
+      return runInfer(argc - 1, argv + 1);
+   }
+   
    InputArgs ia;
 
    try { 
@@ -434,16 +1585,105 @@ int main (const int argc, char **argv) {
       return -1;
    }
    
-   // The weights to bias nodes should not be considered in the scheme, as
-   // they are irrelevant as the bias node has a constant value.
-   const auto amountWeights =
-           static_cast<uint16_t>(
-                   (ia.inputnodes  * (ia.hiddennodes - 1))                   +
-                   (ia.hiddennodes * (ia.hiddennodes - 1) * (ia.layers - 1)) +
-                   (ia.hiddennodes * ia.outputnodes));
-   const std::string initialScheme(amountWeights, 'A');
-   const std::unordered_set<std::string> schemes = 
-      generateInitialSchemes(initialScheme);
+   // The floating point mode is inherited by the worker threads.
+   if (ia.safeNumerics) {
+      General::flushDenormals();
+   } else {
+      // Raise an error when one of these float exceptions occur.
+      feenableexcept(FE_DIVBYZERO | FE_INVALID | FE_OVERFLOW | FE_UNDERFLOW);
+   }
+   
+   if (!singleOutput(ia)) { return 1; }
+   
+   if (!ia.loadModel.empty()) {
+      const auto start = std::chrono::steady_clock::now();
+      const Model::Mapped model(ia.loadModel);
+      if (!model.valid()) { return 1; }
+      fprintf(stderr, "Mapped model %s (%s) in %.3f ms.\n",
+              ia.loadModel.c_str(), model.scheme().c_str(),
+              std::chrono::duration< double, std::milli >(
+                 std::chrono::steady_clock::now() - start).count());
+      if (model.header().inputNodes != ia.inputnodes) {
+         fprintf(stderr, "The model has %u inputs, the %s test needs %u!\n",
+                 model.header().inputNodes, ia.test.c_str(), ia.inputnodes);
+         return 1;
+      }
+      Tests tests;
+      tests.modelTest(model, ia.test);
+      return 0;
+   }
+   
+   if (ia.compareActivations) {
+      compareActivations(ia);
+      return 0;
+   }
+   
+   if (ia.scaling) {
+      measureScaling(ia);
+      return 0;
+   }
+   
+   if (ia.searchBudget > 0) {
+      searchSchemes(ia);
+      return 0;
+   }
+   
+   if (ia.warmEpochs > 0) {
+      compareWarmStart(ia);
+      return 0;
+   }
+   
+   if (!ia.cacheFolder.empty() && !cache.open(ia.cacheFolder)) { return 1; }
+   
+   if (!ia.sweepFile.empty()) {
+      if (ia.shard.count > 0 || ia.launchShards > 0 || ia.mergeShards > 0) {
+         fprintf(stderr, "A sweep spec can not be sharded!\n");
+         return 1;
+      }
+      return runSweep(ia);
+   }
+   
+   if (ia.adaptiveBudget > 0 &&
+       (ia.shard.count > 0 || ia.launchShards > 0 || ia.mergeShards > 0)) {
+      fprintf(stderr, "Adaptive seeds can not be sharded!\n");
+      return 1;
+   }
+   
+   if (ia.mergeShards > 0) {
+      return Shard::merge(ia.folder, ia.mergeShards) ? 0 : 1;
+   }
+   // A shard started by the launcher gets the launch option as well
+   if (ia.launchShards > 0 && ia.shard.count == 0) {
+      return static_cast<int>(
+                Shard::launch(argc, argv, ia.launchShards, ia.folder));
+   }
+   
+   // A shard writes to its own folder, and remembers whether it is done
+   const std::string baseFolder = ia.folder;
+   if (ia.shard.count > 0) {
+      if (Shard::status(baseFolder, ia.shard) == "done") { return 0; }
+      ia.folder = Shard::folder(baseFolder, ia.shard);
+      // Throw away the results of an earlier, failed, attempt
+      __attribute__((unused)) const auto unused =
+                  static_cast<uint16_t>(system(("rm -rf " + ia.folder +
+                                                " && mkdir -p " + ia.folder +
+                                                " 2> /dev/null").c_str()));
+      Shard::status(baseFolder, ia.shard, "running");
+   }
+   
+   if (!ia.traceFile.empty()) { Trace::enable(ia.traceFile); }
+   
+   // One catalogue of the schemes, shared by all threads
+   Catalogue catalogue;
+   try {
+      const uint64_t length = ia.randomWeights ? 0 : amountWeights(ia);
+      catalogue = ia.catalogueFile.empty() ?
+                  Catalogue::generate(length) :
+                  Catalogue::cached(ia.catalogueFile, length);
+   } catch (std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+   }
    
    // These are created as struct variables cannot be passed to an async function.
    // They are used, although code analysis may deny that.
@@ -451,30 +1691,97 @@ int main (const int argc, char **argv) {
    const auto inputs = ia.inputnodes;
    const auto outputs = ia.outputnodes;
    
-   if (ia.schemes) {
-      updateStatusBar(0.0); // should be empty at the start
-      //TODO: Remove the comment tags around the 0! 
-      const uint16_t startseed = 100, endseed = 1000, stepseed = 10;
-      const uint32_t steps = (endseed / stepseed) - ((startseed - 1) / stepseed);
-
+   const std::vector<uint16_t> seeds = sweepSeeds(ia);
+   
+   uint64_t totalJobs = 0;
+   for (uint64_t job = 0; job < seeds.size() * catalogue.size(); job++) {
+      if (Shard::owns(ia.shard, job)) { totalJobs++; }
+   }
+   
+   // The adaptive seeds go to a pool of workers instead of a thread per seed
+   const bool adaptive = ia.adaptiveBudget > 0;
+   if (adaptive) { totalJobs = ia.adaptiveBudget; }
+   const auto steps = adaptive ? std::max(1u, std::thread::hardware_concurrency()) :
+                                 static_cast<uint32_t>(seeds.size());
+   
+   std::vector< Placement::Node > nodes;
+   if (ia.placement != Placement::NONE) {
+      nodes = Placement::topology();
+      // A first round warms up the caches and the allocator
+      measureThroughput(ia, nodes, Placement::NONE, steps);
+      const double unpinned = measureThroughput(ia, nodes, Placement::NONE, steps);
+      const double pinned = measureThroughput(ia, nodes, ia.placement, steps);
+      fprintf(stderr, "Pinning %u workers (%s) to %s.\n"
+                      "Throughput unpinned %.0f epochs/s, pinned %.0f "
+                      "epochs/s (%+.1f%%).\n",
+              steps, Placement::name(ia.placement).c_str(),
+              Placement::describe(nodes).c_str(), unpinned, pinned,
+              unpinned > 0.0 ? 100.0 * (pinned / unpinned - 1.0) : 0.0);
+   }
+   
+   progress.start(steps, totalJobs, ia.epochs);
+   progress.report(ia.schemes || adaptive, ia.metricsFile, ia.metricsInterval);
+   evaluator.dumps(ia.dumps);
+   evaluator.start((steps + 7) / 8, ia.evalQueue);
+   
+   std::string allocated;
+   if (adaptive) {
+      allocated = runAdaptive(catalogue, ia, steps, nodes);
+   } else if (ia.schemes) {
       std::vector< std::future< void > > threads(steps);
 
-      for (uint16_t s = startseed; s <= endseed; s += stepseed) {
-         threads[(s/10 - 10)] = async(std::launch::async,
-                                      [schemes,
-                                       ia,
-                                       inputs,
-                                       outputs,
-                                       s,
-                                       toFile] {
-            runSchemes(schemes, ia, s);
-            updateStatusBar(1.0 / (float) steps);
+      const Catalogue *shared = &catalogue;
+      const std::vector< Placement::Node > *placement = &nodes;
+      for (uint32_t i = 0; i < steps; i++) {
+         const uint16_t s = seeds[i];
+         threads[i] = async(std::launch::async,
+                            [shared,
+                             placement,
+                             &ia,
+                             inputs,
+                             outputs,
+                             i,
+                             s,
+                             toFile] {
+            Progress::worker(i);
+            // Bind first, so everything the worker allocates from
+            // here on, its own arguments included, is on its node.
+            Placement::pin(*placement, ia.placement, i);
+            const InputArgs local = ia;
+            runSchemes(*shared, local, s, i);
          });
       }
+      joinWorkers(threads);
    } else {
-      runSchemes(schemes, ia, ia.seed);
+      Placement::pin(nodes, ia.placement, 0);
+      runSchemes(catalogue, ia, ia.seed, 0);
+   }
+   // All workers have finished once the futures are joined
+   evaluator.stop();
+   if (evaluator.stalled() > 0.0) {
+      fprintf(stderr, "\nThe workers together waited %.1f ms for room to test their "
+                      "checkpoints, a larger --eval-queue could help.\n",
+              evaluator.stalled());
+   }
+   progress.stop();
+   Trace::write();
+   if (adaptive) { fprintf(stderr, "\n%s.", allocated.c_str()); }
+   const std::string summary = ia.toFile ? ia.folder + "schemes.summary" : "";
+   if (statistics.write(summary, ia.topSchemes) && ia.toFile) {
+      const std::vector< Statistics::Entry > best = statistics.leaders(1);
+      fprintf(stderr, "\nWrote the statistics of %llu schemes to %s",
+              static_cast<unsigned long long>(statistics.schemes()), summary.c_str());
+      if (!best.empty()) {
+         fprintf(stderr, ", the best is %s with a mean error of %g over %llu seeds",
+                 best[0].scheme.c_str(), best[0].running.mean,
+                 static_cast<unsigned long long>(best[0].running.count));
+      }
+      fprintf(stderr, ".");
    }
+   reportValidations();
+   if (cache.enabled()) { fprintf(stderr, "\n%s.", cache.describe().c_str()); }
+   if (ia.shard.count > 0) { Shard::status(baseFolder, ia.shard, "done"); }
    //to prevent the statusbar from staying at the bottom of the terminal
    std::cout << std::endl; 
-   return 0;
+   return workerFailed ? 1 : 0;
 }
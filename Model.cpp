@@ -0,0 +1,237 @@
+#include "Model.hpp"
+
+namespace {
+   uint64_t aligned(const uint64_t offset) {
+      return (offset + Model::alignment - 1) / Model::alignment * Model::alignment;
+   }
+
+   // Rows and columns of every layer of weights, from the inputs
+   // to the output.
+   std::vector< std::pair< uint64_t, uint64_t > > shapes(const Model::Header& h) {
+      std::vector< std::pair< uint64_t, uint64_t > > s;
+      s.emplace_back(h.inputNodes, h.hiddenNodes);
+      for (uint32_t l = 0; l + 1 < h.hiddenLayers; l++) {
+         s.emplace_back(h.hiddenNodes, h.hiddenNodes);
+      }
+      s.emplace_back(h.hiddenNodes, h.outputNodes);
+      return s;
+   }
+
+   // Where every layer starts, followed by where the weights end
+   std::vector< uint64_t > offsets(const Model::Header& h) {
+      std::vector< uint64_t > o;
+      uint64_t offset = h.weightsOffset;
+      for (const auto& shape : shapes(h)) {
+         o.push_back(offset);
+         offset = aligned(offset + shape.first * shape.second * sizeof(double));
+      }
+      o.push_back(offset);
+      return o;
+   }
+
+   void writeLayer(FILE *of, const vecvecdo& w, const uint64_t end) {
+      for (const vecdo& row : w) {
+         fwrite(row.data(), sizeof(double), row.size(), of);
+      }
+      const char zeros[Model::alignment] = {0};
+      fwrite(zeros, 1, static_cast<size_t>(end - static_cast<uint64_t>(ftell(of))), of);
+   }
+}
+
+bool Model::save(const Network& n, const std::string& file) {
+   /*
+    * The model is written to a temporary file first and then
+    * renamed, so a worker mapping it never sees half a model.
+    */
+   if (n.amOutputNodes() != 1) {
+      fprintf(stderr, "Could not write model %s, a model has a single output!\n",
+              file.c_str());
+      return false;
+   }
+   Header h = {};
+   std::memcpy(h.magic, magic, sizeof(magic));
+   h.version      = version;
+   h.byteOrder    = byteOrder;
+   h.activation   = n.activation();
+   h.inputNodes   = n.amInputNodes();
+   h.hiddenNodes  = n.amHiddenNodes();
+   h.hiddenLayers = n.amHiddenLayers();
+   h.outputNodes  = static_cast<uint32_t>(n.weightsToOutput(0).size());
+   h.schemeLength = static_cast<uint32_t>(n.scheme().size());
+   h.weightsOffset = alignment;
+   const std::vector< uint64_t > o = offsets(h);
+   h.schemeOffset = o.back();
+   h.fileSize     = h.schemeOffset + h.schemeLength;
+
+   const std::string tmpFile = file + ".tmp";
+   FILE *of = fopen(tmpFile.c_str(), "wb");
+   if (of == nullptr) {
+      fprintf(stderr, "Could not write model %s!\n", file.c_str());
+      return false;
+   }
+   fwrite(&h, sizeof(h), 1, of);
+   writeLayer(of, n.weightsFromInputs(), o[1]);
+   for (uint32_t l = 0; l + 1 < h.hiddenLayers; l++) {
+      writeLayer(of, n.weightsHiddenLayers(l), o[l + 2]);
+   }
+   writeLayer(of, n.weightsToOutput(), o.back());
+   fwrite(n.scheme().data(), 1, h.schemeLength, of);
+   const bool written = ferror(of) == 0;
+   fclose(of);
+   if (!written || rename(tmpFile.c_str(), file.c_str()) != 0) {
+      fprintf(stderr, "Could not write model %s!\n", file.c_str());
+      remove(tmpFile.c_str());
+      return false;
+   }
+   return true;
+}
+
+Model::Mapped::Mapped(const std::string& file) {
+   /*
+    * Map the file and check it really is a model of this version,
+    * written on a machine with the same byte order, and that
+    * every part the header points to lies within the file.
+    */
+   const int fd = open(file.c_str(), O_RDONLY);
+   if (fd < 0) {
+      fprintf(stderr, "Could not open model %s!\n", file.c_str());
+      return;
+   }
+   struct stat st = {};
+   if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+      fprintf(stderr, "Model %s is too small!\n", file.c_str());
+      close(fd);
+      return;
+   }
+   _size = static_cast<size_t>(st.st_size);
+   _data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (_data == MAP_FAILED) {
+      fprintf(stderr, "Could not map model %s!\n", file.c_str());
+      _data = nullptr;
+      return;
+   }
+
+   const auto *h = static_cast<const Header*>(_data);
+   const char *problem = nullptr;
+   if (std::memcmp(h->magic, magic, sizeof(magic)) != 0) {
+      problem = "is not a model";
+   } else if (h->version != version) {
+      problem = "has an unsupported version";
+   } else if (h->byteOrder != byteOrder) {
+      problem = "was written with a different byte order";
+   } else if (h->activation >= Activation::AMOUNT) {
+      problem = "has an unknown activation";
+   } else if (h->inputNodes < 2 || h->hiddenNodes < 2 ||
+              h->hiddenLayers < 1 || h->outputNodes != 1) {
+      problem = "has an unsupported topology";
+   } else if (h->fileSize != _size || h->weightsOffset % alignment != 0 ||
+              offsets(*h).back() != h->schemeOffset ||
+              h->schemeOffset + h->schemeLength != _size) {
+      problem = "is truncated or corrupt";
+   }
+   if (problem != nullptr) {
+      fprintf(stderr, "Model %s %s!\n", file.c_str(), problem);
+      munmap(_data, _size);
+      _data = nullptr;
+      return;
+   }
+
+   _header = h;
+   const std::vector< uint64_t > o = offsets(*h);
+   for (size_t l = 0; l + 1 < o.size(); l++) {
+      _layers.push_back(reinterpret_cast<const double*>(
+                           static_cast<const char*>(_data) + o[l]));
+   }
+}
+
+Model::Mapped::~Mapped() {
+   if (_data != nullptr) { munmap(_data, _size); }
+}
+
+std::string Model::Mapped::scheme() const {
+   return std::string(static_cast<const char*>(_data) + _header->schemeOffset,
+                      _header->schemeLength);
+}
+
+template < typename A >
+double Model::Mapped::forwardWith(const double *inputs) const {
+   /*
+    * The same forward propagation as Network::propagateWith(),
+    * on the mapped weights. The buffers are kept per thread.
+    */
+   thread_local vecdo activations, layer;
+   const uint32_t inputSize   = _header->inputNodes;
+   const uint32_t hiddenNodes = _header->hiddenNodes;
+   const uint32_t outputNodes = _header->outputNodes;
+
+   activations.resize(std::max(inputSize, hiddenNodes));
+   layer.resize(hiddenNodes);
+   for (uint32_t i = 0; i < inputSize; i++) {
+      activations[i] = General::sigmoid(inputs[i]);
+   }
+
+   const double *w = _layers[0];
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      //bias has value -1
+      layer[h] = -w[static_cast<size_t>(inputSize - 1) * hiddenNodes + h];
+   }
+   Kernels::multiplyAdd(w, hiddenNodes, activations.data(),
+                        inputSize - 1, hiddenNodes, layer.data());
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      activations[h] = A::f(layer[h]);
+   }
+
+   for (uint32_t l = 0; l + 1 < _header->hiddenLayers; l++) {
+      w = _layers[l + 1];
+      for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
+         layer[hn] = -w[static_cast<size_t>(hiddenNodes - 1) * hiddenNodes + hn];
+      }
+      Kernels::multiplyAdd(w, hiddenNodes, activations.data(),
+                           hiddenNodes - 1, hiddenNodes - 1, layer.data());
+      for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
+         activations[h] = A::f(layer[h]);
+      }
+   }
+
+   // only 1 output
+   w = _layers.back();
+   double output = -w[static_cast<size_t>(hiddenNodes - 1) * outputNodes];
+   for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
+      output += w[static_cast<size_t>(h) * outputNodes] * activations[h];
+   }
+   return output;
+}
+
+template < typename A >
+void Model::Mapped::forwardBatch(const double *inputs,
+                                 const size_t count,
+                                 double *outputs) const {
+   const uint32_t inputSize = _header->inputNodes;
+   for (size_t c = 0; c < count; c++) {
+      outputs[c] = forwardWith< A >(inputs + c * inputSize);
+   }
+}
+
+double Model::Mapped::forward(const vecdo& inputs) const {
+   assert(inputs.size() == _header->inputNodes && "Wrong amount of inputs for the model!");
+   double output;
+   forward(inputs.data(), 1, &output);
+   return output;
+}
+
+void Model::Mapped::forward(const double *inputs,
+                            const size_t count,
+                            double *outputs) const {
+   // The activation is looked up once for all cases
+   switch (static_cast<Activation::Type>(_header->activation)) {
+      case Activation::TANH:
+         return forwardBatch< Activation::Tanh >(inputs, count, outputs);
+      case Activation::RELU:
+         return forwardBatch< Activation::Relu >(inputs, count, outputs);
+      case Activation::HARDSIGMOID:
+         return forwardBatch< Activation::HardSigmoid >(inputs, count, outputs);
+      default:
+         return forwardBatch< Activation::Sigmoid >(inputs, count, outputs);
+   }
+}
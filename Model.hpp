@@ -0,0 +1,86 @@
+#ifndef MODEL_HPP
+#define MODEL_HPP
+
+#include "Includes.hpp"
+
+#include "Network.hpp"
+
+namespace Model {
+   /*
+    * A trained network on disk, in a binary format which can be
+    * mapped into memory and used as is.
+    * The file starts with a header of 64 bytes, followed by the
+    * weights as doubles, layer by layer and per row, with every
+    * layer starting at a multiple of 64 bytes. The scheme follows
+    * the weights. The numbers are stored in the byte order of the
+    * machine which wrote the file, which the header records.
+    */
+
+   const char magic[8] = {'D', 'L', 'N', 'M', 'O', 'D', 'E', 'L'};
+   const uint32_t version = 1;
+   const uint32_t byteOrder = 0x01020304;
+   const uint64_t alignment = 64;
+
+   struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byteOrder;
+      uint32_t activation;   // of the hidden nodes, an Activation::Type
+      uint32_t inputNodes;   // including the bias node
+      uint32_t hiddenNodes;  // including the bias node
+      uint32_t hiddenLayers;
+      uint32_t outputNodes;
+      uint32_t schemeLength;
+      uint64_t weightsOffset;
+      uint64_t schemeOffset;
+      uint64_t fileSize;
+   };
+   static_assert(sizeof(Header) == alignment, "The header should fill 64 bytes");
+
+   // Write the network to file, returns false if that failed.
+   bool save(const Network& n, const std::string& file);
+
+   class Mapped {
+      /*
+       * A model file mapped into memory. Nothing is read from it
+       * until it is used, so opening it takes the same time for
+       * any size of model, and the pages are shared between all
+       * processes using the same file.
+       */
+   public:
+      explicit Mapped(const std::string& file);
+      ~Mapped();
+
+      Mapped(const Mapped&) = delete;
+      Mapped& operator=(const Mapped&) = delete;
+
+      // False if the file could not be mapped or is not a valid model
+      bool valid() const { return _header != nullptr; }
+
+      const Header& header() const { return *_header; }
+      std::string scheme() const;
+
+      // The output of the network for the given inputs, before the
+      // final sigmoid. Gives exactly the same result as the network
+      // which was saved. Safe to call from multiple threads at once.
+      double forward(const vecdo& inputs) const;
+      // The same for count cases at once: inputs holds inputNodes
+      // values per case, the bias node included, and outputs gets
+      // one value per case.
+      void forward(const double *inputs, size_t count, double *outputs) const;
+
+   private:
+      template < typename A >
+      double forwardWith(const double *inputs) const;
+      template < typename A >
+      void forwardBatch(const double *inputs, size_t count, double *outputs) const;
+
+      void *_data = nullptr;
+      size_t _size = 0;
+      const Header *_header = nullptr;
+      // The first weight of every layer of weights
+      std::vector< const double* > _layers;
+   };
+}
+
+#endif
@@ -14,10 +14,21 @@ Network::Network(const vecdo&                   inputs,
    _hiddenLayers        = hL;
    _weightsHiddenLayers = wHL;
    _weightsToOutput     = wTO;
-   _expectedOutput      = eO;
+   _expectedOutputs     = vecdo(wTO[0].size(), eO);
    _alpha               = alpha;
-   _calculatedOutput    = cO;
+   _calculatedOutputs   = vecdo(wTO[0].size(), cO);
    _scheme              = scheme;
+   _activations         = activationShape();
+}
+
+void Network::optimizer(const Optimizer& a) {
+   /*
+    * Set the optimizer, and give it fresh state shaped
+    * like the weights.
+    */
+   _optimizer = a;
+   _moments   = a.amState() > 0 ? zeroState() : WeightState();
+   _variances = a.amState() > 1 ? zeroState() : WeightState();
 }
 
 void Network::initialiseWeights(const uint16_t seed,
@@ -36,172 +47,741 @@ void Network::initialiseWeights(const uint16_t seed,
    
    bool useScheme = false;
    if (!schemeWeights.empty()) { useScheme = true; }
+   unsigned int state = seed;
+   
+   assert((!useScheme || schemeWeights.size() == schemeLength()) &&
+          "Scheme weights of the wrong length!");
    
-   for (uint16_t i = 0; i < inputNodes; i++) {
-      for (uint16_t h = 0; h < hiddenNodes - 1; h++) {
+   for (uint32_t i = 0; i < inputNodes; i++) {
+      for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
          _weightsFromInputs[i][h] = useScheme ?
-                                   schemeWeights[i*hiddenNodes + h] :
-                                   General::randomWeight(seed);
+                                   schemeWeights[inputPosition(i, h)] :
+                                   General::randomWeight(state);
       }
    }
 
-   for (uint16_t l = 0; l < hiddenLayers - 1; l++) {
-      for (uint16_t hp = 0; hp < hiddenNodes; hp++) {
-         for (uint16_t hn = 0; hn < hiddenNodes - 1; hn++) {
+   for (uint32_t l = 0; l < hiddenLayers - 1; l++) {
+      for (uint32_t hp = 0; hp < hiddenNodes; hp++) {
+         for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
             _weightsHiddenLayers[l][hp][hn] = 
                useScheme ?
-                  schemeWeights[(inputNodes * (hiddenNodes - 1)) +
-                                (l * hiddenNodes) + hp + hn] :
-                  General::randomWeight(seed);
+                  schemeWeights[hiddenPosition(l, hp, hn)] :
+                  General::randomWeight(state);
          }
       }
    }
 
-   for (uint16_t h = 0; h < hiddenNodes; h++) {
-      for (uint16_t o = 0; o < outputNodes; o++) {
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      for (uint32_t o = 0; o < outputNodes; o++) {
          _weightsToOutput[h][o] = useScheme ?
-                                  schemeWeights[
-                                       (inputNodes * (hiddenNodes - 1)) +
-                                        ((hiddenLayers - 1) *
-                                         hiddenNodes * (hiddenNodes - 1)) +
-                                       (o * hiddenNodes + h)]:
-                                  General::randomWeight(seed);
+                                  schemeWeights[outputPosition(h, o)] :
+                                  General::randomWeight(state);
       }
    }
 }
 
-void Network::forward() {
+size_t Network::schemeLength() const {
+   const size_t hiddenNodes = amHiddenNodes();
+   return amInputNodes() * (hiddenNodes - 1) +
+          (amHiddenLayers() - 1) * hiddenNodes * (hiddenNodes - 1) +
+          hiddenNodes * amOutputNodes();
+}
+
+size_t Network::inputPosition(const uint32_t i, const uint32_t h) const {
+   return static_cast<size_t>(i) * (amHiddenNodes() - 1) + h;
+}
+
+size_t Network::hiddenPosition(const uint32_t l,
+                               const uint32_t hp,
+                               const uint32_t hn) const {
+   const size_t hiddenNodes = amHiddenNodes();
+   return amInputNodes() * (hiddenNodes - 1) +
+          l * hiddenNodes * (hiddenNodes - 1) +
+          hp * (hiddenNodes - 1) + hn;
+}
+
+size_t Network::outputPosition(const uint32_t h, const uint32_t o) const {
+   const size_t hiddenNodes = amHiddenNodes();
+   return amInputNodes() * (hiddenNodes - 1) +
+          (amHiddenLayers() - 1) * hiddenNodes * (hiddenNodes - 1) +
+          o * hiddenNodes + h;
+}
+
+void Network::reset(const uint16_t seed,
+                    const std::string& scheme,
+                    const vecdo& schemeWeights/* = {}*/) {
    /*
-    * Basically a forward propagation through the network.
-    * _calculatedOutput contains the result of the
-    * propagation.
+    * Everything the constructor and initialiseWeights() set,
+    * to the values a network made by Dln::build() starts with.
+    * initialiseWeights() leaves the weights into the bias nodes
+    * alone, so all weights are zeroed first. The buffers of the
+    * training threads are kept, as they are overwritten before
+    * they are read.
     */
-   const auto hiddenLayers = amHiddenLayers();
-   const auto hiddenNodes  = amHiddenNodes();
-   
+   const auto zero = [](vecvecdo& rows) {
+      for (vecdo& row : rows) { std::fill(row.begin(), row.end(), 0.0); }
+   };
+   std::fill(_inputs.begin(), _inputs.end(), 0.0);
+   zero(_weightsFromInputs);
+   for (vecvecdo& layer : _weightsHiddenLayers) { zero(layer); }
+   zero(_weightsToOutput);
+   zero(_activations);
+   for (vecdo& layer : _hiddenLayers) {
+      std::fill(layer.begin(), layer.end(), 0.0);
+      layer.back() = -1.0;
+   }
+   std::fill(_expectedOutputs.begin(), _expectedOutputs.end(), 0.0);
+   std::fill(_calculatedOutputs.begin(), _calculatedOutputs.end(), 0.0);
+   _scheme           = scheme;
+   _saturated        = 0;
+   _nonFinite        = 0;
+   _pruned           = false;
+   _optimizer.restart();
+   clear(_moments);
+   clear(_variances);
+   initialiseWeights(seed, schemeWeights);
+}
+
+vecdo Network::schemeWeights() const {
    /*
-   std::cerr << "Inputs: ";
-   for (auto i : _inputs) { std::cerr << i << "; "; }
-   std::cerr << std::endl;
-   
-   std::cerr << "Weights: ";
-   for (uint16_t h = 0; h < hiddenNodes - 1; h++) {
-      for (uint16_t i = 0; i < _inputs.size(); i++) {
-         std::cerr << _weightsFromInputs[i][h] << "; ";
+    * The same positions as in initialiseWeights(). Every
+    * position is checked to be filled by exactly one weight,
+    * so a scheme read back gives the network it came from.
+    */
+   const auto inputNodes   = amInputNodes();
+   const auto hiddenNodes  = amHiddenNodes();
+   const auto hiddenLayers = amHiddenLayers();
+   const auto outputNodes  = amOutputNodes();
+   const size_t length = schemeLength();
+   vecdo weights(length, 0.0);
+   std::vector< uint32_t > counts(length, 0);
+   const auto put = [&](const size_t position, const double weight) {
+      assert(position < length && "Scheme position out of range!");
+      weights[position] = weight;
+      counts[position]++;
+   };
+
+   for (uint32_t i = 0; i < inputNodes; i++) {
+      for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
+         put(inputPosition(i, h), _weightsFromInputs[i][h]);
       }
    }
-   std::cerr << std::endl;
-   */
+   for (uint32_t l = 0; l < hiddenLayers - 1; l++) {
+      for (uint32_t hp = 0; hp < hiddenNodes; hp++) {
+         for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
+            put(hiddenPosition(l, hp, hn), _weightsHiddenLayers[l][hp][hn]);
+         }
+      }
+   }
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      for (uint32_t o = 0; o < outputNodes; o++) {
+         put(outputPosition(h, o), _weightsToOutput[h][o]);
+      }
+   }
+   for (size_t p = 0; p < length; p++) {
+      assert(counts[p] == 1 && "A scheme position is not one weight!");
+   }
+   return weights;
+}
+
+template < typename A >
+void Network::propagateWith(const vecdo& inputs,
+                            vecvecdo& layers,
+                            vecvecdo& activations,
+                            double *outputs) const {
+   /*
+    * Basically a forward propagation through the network.
+    * The values of the hidden nodes are stored in layers,
+    * their activations (by policy A) in activations, and the
+    * outputs of the network in outputs.
+    * activations[0] holds the sigmoids of the inputs, and
+    * activations[l + 1] the activations of hidden layer l.
+    * This does not change the network, so multiple threads
+    * can propagate through it at the same time, each with
+    * their own buffers.
+    */
+   const auto hiddenLayers = amHiddenLayers();
+   const auto hiddenNodes  = amHiddenNodes();
    
    // Last node of a layer is the bias node, having a constant value of -1.
 
-   const auto inputSize = _inputs.size();
-   for (uint16_t h = 0; h < hiddenNodes; h++) {
+   const auto inputSize = static_cast<uint32_t>(inputs.size());
+   for (uint32_t i = 0; i < inputSize; i++) {
+      activations[0][i] = General::sigmoid(inputs[i]);
+   }
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
       //bias has value -1
-      _hiddenLayers[0][h] = -_weightsFromInputs[inputSize - 1][h];
-      for (uint16_t i = 0; i < inputSize - 1; i++) {
-         _hiddenLayers[0][h] +=
-            _weightsFromInputs[i][h] * General::sigmoid(_inputs[i]);
-      }
+      layers[0][h] = -_weightsFromInputs[inputSize - 1][h];
+   }
+   if (_pruned && _sparse.fromInputs.active) {
+      Kernels::multiplyAdd(_weightsFromInputs, _sparse.fromInputs,
+                           activations[0].data(),
+                           inputSize - 1, hiddenNodes, layers[0].data());
+   } else {
+      Kernels::multiplyAdd(_weightsFromInputs, activations[0].data(),
+                           inputSize - 1, hiddenNodes, layers[0].data());
+   }
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      activations[1][h] = A::f(layers[0][h]);
    }
 
    //hp is hidden previous
    //hn is hidden next
    //for the previous and next hidden layer
-   for (uint16_t l = 0; l < hiddenLayers - 1; l++) {
-      for (uint16_t hn = 0; hn < hiddenNodes - 1; hn++) {
+   for (uint32_t l = 0; l < hiddenLayers - 1; l++) {
+      for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
          //bias has value -1
-         _hiddenLayers[l + 1][hn] = -_weightsHiddenLayers[l][hiddenNodes - 1][hn];
-         for (uint16_t hp = 0; hp < hiddenNodes - 1; hp++) {
-            _hiddenLayers[l + 1][hn] +=
-               _weightsHiddenLayers[l][hp][hn] * 
-               General::sigmoid(_hiddenLayers[l][hp]);
-         }
+         layers[l + 1][hn] = -_weightsHiddenLayers[l][hiddenNodes - 1][hn];
+      }
+      if (_pruned && _sparse.hiddenLayers[l].active) {
+         Kernels::multiplyAdd(_weightsHiddenLayers[l], _sparse.hiddenLayers[l],
+                              activations[l + 1].data(),
+                              hiddenNodes - 1, hiddenNodes - 1,
+                              layers[l + 1].data());
+      } else {
+         Kernels::multiplyAdd(_weightsHiddenLayers[l], activations[l + 1].data(),
+                              hiddenNodes - 1, hiddenNodes - 1,
+                              layers[l + 1].data());
+      }
+      for (uint32_t h = 0; h < hiddenNodes; h++) {
+         activations[l + 2][h] = A::f(layers[l + 1][h]);
       }
    }
 
-   // only 1 output
-   _calculatedOutput = -_weightsToOutput[hiddenNodes - 1][0];
-   for (uint16_t h = 0; h < hiddenNodes - 1; h++) {
-      _calculatedOutput += _weightsToOutput[h][0] *
-                           General::sigmoid(_hiddenLayers[hiddenLayers - 1][h]);
+   // All outputs at once, from the same hidden nodes
+   const auto outputNodes = amOutputNodes();
+   for (uint32_t o = 0; o < outputNodes; o++) {
+      //bias has value -1
+      outputs[o] = -_weightsToOutput[hiddenNodes - 1][o];
    }
+   Kernels::multiplyAdd(_weightsToOutput, activations[hiddenLayers].data(),
+                        hiddenNodes - 1, outputNodes, outputs);
 }
 
-void Network::train() {
+void Network::propagate(const vecdo& inputs,
+                        vecvecdo& layers,
+                        vecvecdo& activations,
+                        double *outputs) const {
+   switch (_activation) {
+      case Activation::TANH:
+         return propagateWith< Activation::Tanh >(inputs, layers, activations,
+                                                  outputs);
+      case Activation::RELU:
+         return propagateWith< Activation::Relu >(inputs, layers, activations,
+                                                  outputs);
+      case Activation::HARDSIGMOID:
+         return propagateWith< Activation::HardSigmoid >(inputs, layers,
+                                                         activations, outputs);
+      default:
+         return propagateWith< Activation::Sigmoid >(inputs, layers, activations,
+                                                     outputs);
+   }
+}
+
+void Network::checkHealth(const vecvecdo& layers,
+                          const double *outputs,
+                          uint64_t& saturated,
+                          uint64_t& nonFinite) const {
    /*
-    * Both forward and backward propagation through the
-    * network. First the forward propagation is done in
-    * forward(), as testing it is done by forward
+    * Keep count of the numerical health of the network:
+    * the nodes in the flat parts of their activation, and
+    * outputs which are NaN or infinite.
+    */
+   const auto hiddenNodes = amHiddenNodes();
+   const double limit = Activation::limit(_activation);
+   for (const vecdo& layer : layers) {
+      for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
+         if (std::fabs(layer[h]) >= limit) { saturated++; }
+      }
+   }
+   for (uint32_t o = 0; o < amOutputNodes(); o++) {
+      if (std::fabs(outputs[o]) >= General::sigmoidLimit) { saturated++; }
+      if (!std::isfinite(outputs[o])) { nonFinite++; }
+   }
+}
+
+void Network::forward() {
+   /*
+    * Forward propagation of the inputs of the network.
+    * _calculatedOutputs contains the result of the
     * propagation.
-    * For the backward propagation some optimisation may
-    * be possible, but it works for now.
+    */
+   propagate(_inputs, _hiddenLayers, _activations, _calculatedOutputs.data());
+   checkHealth(_hiddenLayers, _calculatedOutputs.data(), _saturated, _nonFinite);
+}
+
+template < typename A >
+void Network::forwardBatch(const vecvecdo& inputs,
+                           const size_t begin,
+                           const size_t end,
+                           double *outputs) const {
+   // The buffers are shared by all cases of the batch
+   vecvecdo layers = _hiddenLayers;
+   vecvecdo activations = activationShape();
+   const auto outputNodes = amOutputNodes();
+   for (size_t c = begin; c < end; c++) {
+      propagateWith< A >(inputs[c], layers, activations,
+                         outputs + (c - begin) * outputNodes);
+   }
+}
+
+void Network::forward(const vecvecdo& inputs,
+                      const size_t begin,
+                      const size_t end,
+                      double *outputs) const {
+   // The activation is looked up once for all cases
+   switch (_activation) {
+      case Activation::TANH:
+         return forwardBatch< Activation::Tanh >(inputs, begin, end, outputs);
+      case Activation::RELU:
+         return forwardBatch< Activation::Relu >(inputs, begin, end, outputs);
+      case Activation::HARDSIGMOID:
+         return forwardBatch< Activation::HardSigmoid >(inputs, begin, end,
+                                                        outputs);
+      default:
+         return forwardBatch< Activation::Sigmoid >(inputs, begin, end, outputs);
+   }
+}
+
+template < typename A >
+void Network::backwardWith(const double *expected,
+                           const vecvecdo& activations,
+                           const double *outputs,
+                           double *outputDeltas,
+                           vecvecdo& deltas,
+                           WeightState& directions) const {
+   /*
+    * Backward propagation for a single case, of which the
+    * forward propagation left the activations of its nodes in
+    * activations and its outputs in outputs.
+    * Every output gets its own delta, and the last hidden layer
+    * gets the sum of what the outputs send back, so one pass
+    * serves all targets.
+    * For every weight, the direction it should move in
+    * (minus the gradient of the error) is added to
+    * directions, so multiple cases can be summed up.
+    * The derivative of the activation is computed from the
+    * activation itself, like y * (1 - y) for the sigmoid.
     */
    const auto hiddenLayers = amHiddenLayers();
    const auto inputNodes   = amInputNodes();
    const auto hiddenNodes  = amHiddenNodes();
    const auto outputNodes  = amOutputNodes();
    
-   // Forward
-   forward();
+   for (uint32_t o = 0; o < outputNodes; o++) {
+      outputDeltas[o] = General::sigmoid_d(outputs[o]) *
+                        (expected[o] - General::sigmoid(outputs[o]));
+   }
+   const vecdo& last = activations[hiddenLayers];
+
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      deltas[hiddenLayers - 1][h] = 0.0;
+      for (uint32_t o = 0; o < outputNodes; o++) {
+         deltas[hiddenLayers - 1][h] += _weightsToOutput[h][o] * outputDeltas[o];
+         // Pruned weights get no direction, so they stay zero
+         if (!_pruned || _weightsToOutput[h][o] != 0.0) {
+            directions.toOutput[h][o] += last[h] * outputDeltas[o];
+         }
+      }
+      deltas[hiddenLayers - 1][h] *= A::df(last[h]);
+   }
 
-   // Backward
-   const double deltaOutput =
-      General::sigmoid_d(_calculatedOutput) *
-      (_expectedOutput - General::sigmoid(_calculatedOutput));
-   vecvecdo deltas(hiddenLayers, vecdo(hiddenNodes, 0.0));
-
-   for (uint16_t h = 0; h < hiddenNodes; h++) {
-      for (uint16_t o = 0; o < outputNodes; o++) {
-         deltas[hiddenLayers - 1][h] += _weightsToOutput[h][o] * deltaOutput;
-         _weightsToOutput[h][o] +=
-              _alpha                                                *
-              General::sigmoid(_hiddenLayers[hiddenLayers - 1][h])  *
-              deltaOutput;
+   for (auto l = static_cast<int32_t>(hiddenLayers - 2); l >= 0; l--) {
+      const vecdo& current = activations[l + 1];
+      std::fill(deltas[l].begin(), deltas[l].end(), 0.0);
+      if (_pruned && _sparse.hiddenLayers[l].active) {
+         Kernels::multiplyRows(_weightsHiddenLayers[l], _sparse.hiddenLayers[l],
+                               deltas[l + 1].data(),
+                               hiddenNodes, hiddenNodes - 1, deltas[l].data());
+      } else {
+         Kernels::multiplyRows(_weightsHiddenLayers[l], deltas[l + 1].data(),
+                               hiddenNodes, hiddenNodes - 1, deltas[l].data());
       }
+      for (uint32_t hp = 0; hp < hiddenNodes; hp++) {
+         deltas[l][hp] *= A::df(current[hp]);
+      }
+      if (_pruned) {
+         Kernels::outerAdd(directions.hiddenLayers[l], _sparse.hiddenLayers[l],
+                           current.data(), deltas[l + 1].data(),
+                           hiddenNodes, hiddenNodes - 1);
+      } else {
+         Kernels::outerAdd(directions.hiddenLayers[l], current.data(),
+                           deltas[l + 1].data(), hiddenNodes, hiddenNodes - 1);
+      }
+   }
+
+   if (_pruned) {
+      Kernels::outerAdd(directions.fromInputs, _sparse.fromInputs,
+                        activations[0].data(), deltas[0].data(),
+                        inputNodes, hiddenNodes - 1);
+   } else {
+      Kernels::outerAdd(directions.fromInputs, activations[0].data(),
+                        deltas[0].data(), inputNodes, hiddenNodes - 1);
+   }
+}
+
+void Network::backward(const double *expected,
+                       const vecvecdo& activations,
+                       const double *outputs,
+                       double *outputDeltas,
+                       vecvecdo& deltas,
+                       WeightState& directions) const {
+   switch (_activation) {
+      case Activation::TANH:
+         return backwardWith< Activation::Tanh >(expected, activations, outputs,
+                                                 outputDeltas, deltas, directions);
+      case Activation::RELU:
+         return backwardWith< Activation::Relu >(expected, activations, outputs,
+                                                 outputDeltas, deltas, directions);
+      case Activation::HARDSIGMOID:
+         return backwardWith< Activation::HardSigmoid >(expected, activations,
+                                                        outputs, outputDeltas,
+                                                        deltas, directions);
+      default:
+         return backwardWith< Activation::Sigmoid >(expected, activations, outputs,
+                                                    outputDeltas, deltas,
+                                                    directions);
+   }
+}
+
+void Network::apply(const WeightState& directions, const double scale) {
+   _optimizer.begin(_alpha);
+   update(directions, scale);
+}
+
+void Network::update(const WeightState& directions, const double scale) {
+   /*
+    * Let the optimizer move every weight along scale times
+    * its direction. Only the weights backward() gives a
+    * direction are touched. The optimizer itself is only
+    * read, so the Hogwild threads can do this at the same time.
+    */
+   const auto hiddenLayers = amHiddenLayers();
+   const auto inputNodes   = amInputNodes();
+   const auto hiddenNodes  = amHiddenNodes();
+   const auto outputNodes  = amOutputNodes();
    
-      deltas[hiddenLayers - 1][h] *=
-           General::sigmoid_d(_hiddenLayers[hiddenLayers - 1][h]);
+   // The optimizer state is only there if the optimizer uses it
+   const bool hasMoments   = _optimizer.amState() > 0;
+   const bool hasVariances = _optimizer.amState() > 1;
+   double unused = 0.0;
+
+   for (uint32_t h = 0; h < hiddenNodes; h++) {
+      for (uint32_t o = 0; o < outputNodes; o++) {
+         _optimizer.update(
+              _weightsToOutput[h][o],
+              scale * directions.toOutput[h][o],
+              hasMoments   ? _moments.toOutput[h][o]   : unused,
+              hasVariances ? _variances.toOutput[h][o] : unused);
+      }
    }
 
-   for (auto l = static_cast<int16_t>(hiddenLayers - 2); l >= 0; l--) {
-      for (uint16_t hp = 0; hp < hiddenNodes; hp++) {
-         for (uint16_t hn = 0; hn < hiddenNodes - 1; hn++) {
-            deltas[l][hp] +=
-               _weightsHiddenLayers[l][hp][hn] * 
-               deltas[l + 1][hn];
+   for (uint32_t l = 0; l + 1 < hiddenLayers; l++) {
+      for (uint32_t hp = 0; hp < hiddenNodes; hp++) {
+         for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
+            _optimizer.update(
+               _weightsHiddenLayers[l][hp][hn],
+               scale * directions.hiddenLayers[l][hp][hn],
+               hasMoments   ? _moments.hiddenLayers[l][hp][hn]   : unused,
+               hasVariances ? _variances.hiddenLayers[l][hp][hn] : unused);
          }
-         deltas[l][hp] *= General::sigmoid_d(_hiddenLayers[l][hp]);
-         for (uint16_t hn = 0; hn < hiddenNodes - 1; hn++) {
-            _weightsHiddenLayers[l][hp][hn] +=
-               _alpha * 
-               General::sigmoid(_hiddenLayers[l][hp]) * 
-               deltas[l + 1][hn];
+      }
+   }
+
+   for (uint32_t i = 0; i < inputNodes; i++) {
+      for (uint32_t h = 0; h < hiddenNodes - 1; h++) {
+         _optimizer.update(
+            _weightsFromInputs[i][h],
+            scale * directions.fromInputs[i][h],
+            hasMoments   ? _moments.fromInputs[i][h]   : unused,
+            hasVariances ? _variances.fromInputs[i][h] : unused);
+      }
+   }
+}
+
+void Network::train() {
+   /*
+    * Both forward and backward propagation through the
+    * network. First the forward propagation is done in
+    * forward(), as testing it is done by forward
+    * propagation.
+    * Then the directions of all weights are computed,
+    * and the weights are moved along them.
+    */
+   forward();
+   
+   Worker& w = workerBuffers(1)[0];
+   clear(w.directions);
+   backward(_expectedOutputs.data(), _activations, _calculatedOutputs.data(),
+            w.outputDeltas.data(), w.deltas, w.directions);
+   apply(w.directions, 1.0);
+}
+
+template < typename Expected >
+void Network::trainBatchWith(const vecvecdo& inputs,
+                             Expected expected,
+                             const unsigned int threads,
+                             const Parallel mode) {
+   /*
+    * One training step on a whole batch of cases, split over
+    * the given amount of threads. Each thread takes a
+    * contiguous part of the batch.
+    * In the deterministic mode every thread sums the directions
+    * of its cases into its own buffer, and these buffers are
+    * summed up in a fixed order before the weights are updated
+    * once, so the result does not depend on the timing of the
+    * threads.
+    * In the Hogwild mode every thread updates the shared weights
+    * after each of its cases, without any locking. The threads
+    * may overwrite each others updates, and the result depends
+    * on the timing, but no thread ever waits for another one.
+    * Only plain SGD keeps no state of its own per weight, so it
+    * is the only optimizer Hogwild can be used with, and its
+    * step is begun once for the whole batch.
+    * The threads are those of the crew of the network, which
+    * are started by the first step and kept for the next ones.
+    */
+   const size_t batchSize = inputs.size();
+   if (batchSize == 0) { return; }
+   const auto amThreads = static_cast<unsigned int>(
+                             std::max< size_t >(1, std::min< size_t >(threads,
+                                                                       batchSize)));
+   std::vector< Worker >& workers = workerBuffers(amThreads);
+   const double scale = 1.0 / static_cast<double>(batchSize);
+   if (mode == HOGWILD) {
+      assert(_optimizer.amState() == 0 && "Hogwild needs a stateless optimizer!");
+      _optimizer.begin(_alpha);
+   }
+
+   const std::function< void(unsigned int) > work = [&](const unsigned int t) {
+      Worker& w = workers[t];
+      const size_t begin = batchSize * t / amThreads;
+      const size_t end   = batchSize * (t + 1) / amThreads;
+      w.saturated = 0;
+      w.nonFinite = 0;
+      clear(w.directions);
+      for (size_t c = begin; c < end; c++) {
+         propagate(inputs[c], w.layers, w.activations, w.outputs.data());
+         checkHealth(w.layers, w.outputs.data(), w.saturated, w.nonFinite);
+         backward(expected(c), w.activations, w.outputs.data(),
+                  w.outputDeltas.data(), w.deltas, w.directions);
+         if (mode == HOGWILD) {
+            update(w.directions, scale);
+            clear(w.directions);
          }
       }
+   };
+
+   if (!_workers.crew) { _workers.crew.reset(new Crew()); }
+   _workers.crew->run(amThreads, work);
+
+   for (unsigned int t = 0; t < amThreads; t++) {
+      _saturated += workers[t].saturated;
+      _nonFinite += workers[t].nonFinite;
    }
+   if (mode == HOGWILD) { return; }
 
-   for (uint16_t h = 0; h < hiddenNodes - 1; h++) {
-      for (uint16_t i = 0; i < inputNodes; i++) {
-         _weightsFromInputs[i][h] += _alpha *
-                                     General::sigmoid(_inputs[i]) *
-                                     deltas[0][h];
-         /*
-         // Totally not cheating around small numbers
-         double weight = _weightsFromInputs[i][h];
-         double addition = _alpha * General::sigmoid(_inputs[i]) * deltas[0][h];
-         if (weight > 0 && weight < pow(10, -100)) {
-            _weightsFromInputs[i][h] = addition;
-         } else if (weight < 0 && weight > pow(-10, -100)) {
-            _weightsFromInputs[i][h] = addition;
-         } else {
-            _weightsFromInputs[i][h] += addition;
+   // Reduce into the buffer of the first thread, always in the same order
+   WeightState& total = workers[0].directions;
+   for (unsigned int t = 1; t < amThreads; t++) {
+      add(total, workers[t].directions);
+   }
+   apply(total, scale);
+}
+
+void Network::trainBatch(const vecvecdo& inputs,
+                         const vecdo& expected,
+                         const unsigned int threads,
+                         const Parallel mode) {
+   assert(amOutputNodes() == 1 && "Give the expected value of every output!");
+   trainBatchWith(inputs, [&expected](const size_t c) { return &expected[c]; },
+                  threads, mode);
+}
+
+void Network::trainBatch(const vecvecdo& inputs,
+                         const vecvecdo& expected,
+                         const unsigned int threads,
+                         const Parallel mode) {
+   trainBatchWith(inputs, [&expected](const size_t c) { return expected[c].data(); },
+                  threads, mode);
+}
+
+namespace {
+   size_t pruneLayer(vecvecdo& weights,
+                     vecvecdo& moments,
+                     vecvecdo& variances,
+                     const double threshold) {
+      /*
+       * Zero the weights of a layer which are closer to 0 than
+       * threshold, together with their optimizer state.
+       * Returns the amount of weights left.
+       */
+      size_t left = 0;
+      for (size_t i = 0; i < weights.size(); i++) {
+         for (size_t j = 0; j < weights[i].size(); j++) {
+            if (std::fabs(weights[i][j]) < threshold) {
+               weights[i][j] = 0.0;
+               if (!moments.empty())   { moments[i][j] = 0.0; }
+               if (!variances.empty()) { variances[i][j] = 0.0; }
+            } else {
+               left++;
+            }
          }
-         */
       }
+      return left;
+   }
+   
+   size_t sizeOf(const vecvecdo& weights) {
+      return weights.empty() ? 0 : weights.size() * weights[0].size();
    }
 }
 
+void Network::prune(const double threshold, const double cutoff) {
+   /*
+    * Magnitude pruning: every weight closer to 0 than
+    * threshold is set to 0, and is kept at 0 by the training
+    * from now on. The positions of the weights which are left
+    * are indexed per layer, and layers with a density below
+    * cutoff are propagated through with the sparse kernels.
+    */
+   const auto hiddenLayers = amHiddenLayers();
+   WeightState noState;
+   noState.hiddenLayers.resize(hiddenLayers);
+   WeightState& moments   = _moments.fromInputs.empty()   ? noState : _moments;
+   WeightState& variances = _variances.fromInputs.empty() ? noState : _variances;
+   
+   _sparse.hiddenLayers.resize(_weightsHiddenLayers.size());
+   
+   size_t left = pruneLayer(_weightsFromInputs, moments.fromInputs,
+                            variances.fromInputs, threshold);
+   _sparse.fromInputs.build(_weightsFromInputs);
+   _sparse.fromInputs.active =
+      left < cutoff * sizeOf(_weightsFromInputs);
+   
+   // Only the first hiddenLayers - 1 layers of weights are in use
+   for (uint32_t l = 0; l + 1 < hiddenLayers; l++) {
+      left = pruneLayer(_weightsHiddenLayers[l], moments.hiddenLayers[l],
+                        variances.hiddenLayers[l], threshold);
+      _sparse.hiddenLayers[l].build(_weightsHiddenLayers[l]);
+      _sparse.hiddenLayers[l].active =
+         left < cutoff * sizeOf(_weightsHiddenLayers[l]);
+   }
+   
+   pruneLayer(_weightsToOutput, moments.toOutput,
+              variances.toOutput, threshold);
+   _pruned = true;
+}
+
+double Network::density() const {
+   /*
+    * The fraction of the weights which is not pruned.
+    */
+   size_t nonZero = 0, total = 0;
+   auto count = [&](const vecvecdo& weights) {
+      for (const vecdo& row : weights) {
+         for (const double w : row) { nonZero += w != 0.0; }
+      }
+      total += sizeOf(weights);
+   };
+   count(_weightsFromInputs);
+   for (uint32_t l = 0; l + 1 < amHiddenLayers(); l++) {
+      count(_weightsHiddenLayers[l]);
+   }
+   count(_weightsToOutput);
+   return total > 0 ? static_cast<double>(nonZero) / total : 1.0;
+}
+
+double Network::flopsSaved() const {
+   /*
+    * The fraction of the multiplications of a forward and
+    * backward propagation which the sparse kernels skip.
+    * Layers which are still handled densely save nothing.
+    */
+   if (!_pruned) { return 0.0; }
+   size_t skipped = 0, total = 0;
+   auto count = [&](const vecvecdo& weights, const Kernels::Sparse& s) {
+      total += sizeOf(weights);
+      if (s.active) { skipped += sizeOf(weights) - s.nonZero(); }
+   };
+   count(_weightsFromInputs, _sparse.fromInputs);
+   for (uint32_t l = 0; l + 1 < amHiddenLayers(); l++) {
+      count(_weightsHiddenLayers[l], _sparse.hiddenLayers[l]);
+   }
+   total += sizeOf(_weightsToOutput);
+   return total > 0 ? static_cast<double>(skipped) / total : 0.0;
+}
+
+vecvecdo Network::activationShape() const {
+   vecvecdo activations(_hiddenLayers.size() + 1,
+                        vecdo(_hiddenLayers[0].size(), 0.0));
+   activations[0].resize(_inputs.size());
+   return activations;
+}
+
+Network::WeightState Network::zeroState() const {
+   return {
+      vecvecdo(_weightsFromInputs.size(),
+               vecdo(_weightsFromInputs[0].size(), 0.0)),
+      std::vector< vecvecdo >(_weightsHiddenLayers.size(),
+                              vecvecdo(_weightsHiddenLayers[0].size(),
+                                       vecdo(_weightsHiddenLayers[0][0].size(),
+                                             0.0))),
+      vecvecdo(_weightsToOutput.size(),
+               vecdo(_weightsToOutput[0].size(), 0.0))
+   };
+}
+
+void Network::clear(WeightState& state) {
+   for (vecdo& row : state.fromInputs) {
+      std::fill(row.begin(), row.end(), 0.0);
+   }
+   for (vecvecdo& layer : state.hiddenLayers) {
+      for (vecdo& row : layer) { std::fill(row.begin(), row.end(), 0.0); }
+   }
+   for (vecdo& row : state.toOutput) {
+      std::fill(row.begin(), row.end(), 0.0);
+   }
+}
+
+void Network::add(WeightState& to, const WeightState& from) {
+   for (size_t i = 0; i < to.fromInputs.size(); i++) {
+      for (size_t j = 0; j < to.fromInputs[i].size(); j++) {
+         to.fromInputs[i][j] += from.fromInputs[i][j];
+      }
+   }
+   for (size_t l = 0; l < to.hiddenLayers.size(); l++) {
+      for (size_t i = 0; i < to.hiddenLayers[l].size(); i++) {
+         for (size_t j = 0; j < to.hiddenLayers[l][i].size(); j++) {
+            to.hiddenLayers[l][i][j] += from.hiddenLayers[l][i][j];
+         }
+      }
+   }
+   for (size_t i = 0; i < to.toOutput.size(); i++) {
+      for (size_t j = 0; j < to.toOutput[i].size(); j++) {
+         to.toOutput[i][j] += from.toOutput[i][j];
+      }
+   }
+}
+
+std::vector< Network::Worker >& Network::workerBuffers(const unsigned int amount) {
+   /*
+    * The buffers of the training threads are kept between
+    * training steps, so they are only allocated once.
+    */
+   while (_workers.buffers.size() < amount) {
+      _workers.buffers.push_back({zeroState(),
+                                  _hiddenLayers,
+                                  activationShape(),
+                                  vecvecdo(_hiddenLayers.size(),
+                                           vecdo(_hiddenLayers[0].size())),
+                                  vecdo(amOutputNodes()),
+                                  vecdo(amOutputNodes()),
+                                  0,
+                                  0});
+   }
+   return _workers.buffers;
+}
+
 void Network::writeDot(const std::string& filename) {
     /*
      * Writes the network to a file in the DOT format.
@@ -221,39 +801,40 @@ void Network::writeDot(const std::string& filename) {
 
     /* First apply labels to all the nodes. */
 
-    for (uint16_t iindex = 0; iindex < inputNodes; iindex++) {
+    for (uint32_t iindex = 0; iindex < inputNodes; iindex++) {
         fprintf(of, "i%d [label = %f];\n", iindex, _inputs[iindex]);
     }
 
-    for (uint16_t hlindex = 0; hlindex < hiddenLayers; hlindex++) {
-        for (uint16_t hnindex = 0; hnindex < hiddenNodes; hnindex++) {
+    for (uint32_t hlindex = 0; hlindex < hiddenLayers; hlindex++) {
+        for (uint32_t hnindex = 0; hnindex < hiddenNodes; hnindex++) {
             fprintf(of, "h%d%d [label = %f];\n", hlindex, hnindex, _hiddenLayers[hlindex][hnindex]);
         }
     }
 
-    // TODO place for loop when calculatedOutput is a vector
-    fprintf(of, "o0 [label = %f];\n", _calculatedOutput);
+    for (uint32_t out = 0; out < outputNodes; out++) {
+        fprintf(of, "o%d [label = %f];\n", out, _calculatedOutputs[out]);
+    }
 
     /* Then put in all the edges. */
 
-    for (uint16_t i = 0; i < inputNodes; i++) {
-        for (uint16_t hn = 0; hn < hiddenNodes - 1; hn++) {
+    for (uint32_t i = 0; i < inputNodes; i++) {
+        for (uint32_t hn = 0; hn < hiddenNodes - 1; hn++) {
             fprintf(of, "i%d -> h0%d [label = %f];\n", i, hn, _weightsFromInputs[i][hn]);
         }
     }
     
     // -1 to account for the fact there is 1 layer more than edges in between
-    for (uint16_t hl = 0; hl < hiddenLayers - 1; hl++) {
-        for (uint16_t hn1 = 0; hn1 < hiddenNodes; hn1++) {
-            for (uint16_t hn2 = 0; hn2 < hiddenNodes - 1; hn2++) {
+    for (uint32_t hl = 0; hl < hiddenLayers - 1; hl++) {
+        for (uint32_t hn1 = 0; hn1 < hiddenNodes; hn1++) {
+            for (uint32_t hn2 = 0; hn2 < hiddenNodes - 1; hn2++) {
                 fprintf(of, "h%d%d -> h%d%d [label = %f];\n", hl, hn1, hl, hn2, _weightsHiddenLayers[hl][hn1][hn2]);
             }
         }
     }
 
-    const uint16_t lastHiddenLayer = hiddenLayers - 1;
-    for (uint16_t hn = 0; hn < hiddenNodes; hn++) {
-       for (uint16_t out = 0; out < outputNodes; out++) {
+    const uint32_t lastHiddenLayer = hiddenLayers - 1;
+    for (uint32_t hn = 0; hn < hiddenNodes; hn++) {
+       for (uint32_t out = 0; out < outputNodes; out++) {
           fprintf(of, "h%d%d -> o%d [label = %f];\n", lastHiddenLayer, hn, out, _weightsToOutput[hn][out]);
        }
     }
@@ -262,19 +843,22 @@ void Network::writeDot(const std::string& filename) {
     /* And then set the ranks of all nodes. */
 
     fprintf(of, "{ rank=same;");
-    for (uint16_t i = 0; i < _inputs.size(); i++) { fprintf(of, " i%d,", i); }
+    for (uint32_t i = 0; i < _inputs.size(); i++) { fprintf(of, " i%d,", i); }
     // Move filepointer 1 back
     fseek(of, -1, SEEK_CUR);
     fprintf(of, " }\n");
 
-    for (uint16_t hl = 0; hl < _hiddenLayers.size(); hl++) {
+    for (uint32_t hl = 0; hl < _hiddenLayers.size(); hl++) {
         fprintf(of, "{ rank=same;");
-        for (uint16_t hn = 0; hn < _hiddenLayers[0].size(); hn++) { fprintf(of, " h%d%d,", hl, hn); }
+        for (uint32_t hn = 0; hn < _hiddenLayers[0].size(); hn++) { fprintf(of, " h%d%d,", hl, hn); }
         fseek(of, -1, SEEK_CUR);
         fprintf(of, " }\n");
     }
 
-    // In case of multiple output nodes, also implement that
+    fprintf(of, "{ rank=same;");
+    for (uint32_t out = 0; out < outputNodes; out++) { fprintf(of, " o%d,", out); }
+    fseek(of, -1, SEEK_CUR);
+    fprintf(of, " }\n");
 
     // Printed at the end
     fprintf(of, "}");
@@ -3,12 +3,54 @@
 
 #include "Includes.hpp"
 
-#include "General.cpp"
+#include "Activation.hpp"
+#include "Crew.hpp"
+#include "General.hpp"
+#include "Kernels.hpp"
+#include "Optimizer.hpp"
 
 class Network {
 
 private:
    
+   /* Types */
+   
+   // Something for every weight of the network, shaped like the weights.
+   struct WeightState {
+      vecvecdo fromInputs;
+      std::vector< vecvecdo > hiddenLayers;
+      vecvecdo toOutput;
+   };
+   
+   // What a training thread needs for itself.
+   struct Worker {
+      WeightState directions;
+      vecvecdo layers;
+      vecvecdo activations;
+      vecvecdo deltas;
+      vecdo outputs;
+      vecdo outputDeltas;
+      uint64_t saturated;
+      uint64_t nonFinite;
+   };
+   
+   // The nonzero weights of every layer, once the network is pruned.
+   struct SparseLayers {
+      Kernels::Sparse fromInputs;
+      std::vector< Kernels::Sparse > hiddenLayers;
+   };
+   
+   // Scratch buffers and the threads of trainBatch(), which are not
+   // copied along with the network.
+   struct Workers {
+      std::vector< Worker > buffers;
+      std::unique_ptr< Crew > crew;
+      
+      Workers() = default;
+      Workers(const Workers&) {}
+      Workers& operator=(const Workers&) { buffers.clear(); return *this; }
+   };
+   
    /* Variables */
    
    // Layer of nodes which contain the input for the network.
@@ -27,14 +69,19 @@ private:
    // Definitely the most complex data structure of this program.
    std::vector< vecvecdo > _weightsHiddenLayers;
    
-   // The weights on the edges between the last hidden layer and the output node.
-   // This output node then contains the result of the calculations in the network,
+   // The sigmoids of the inputs and the activations of the hidden nodes,
+   // as computed by the last forward propagation. These are reused by
+   // the training.
+   vecvecdo _activations;
+   
+   // The weights on the edges between the last hidden layer and the output nodes.
+   // These output nodes then contain the result of the calculations in the network,
    // based on the given input.
    vecvecdo _weightsToOutput;
    
-   // The value which is expected to be returned, to be compared to
-   // the calculatedOutput
-   double _expectedOutput;
+   // The values which are expected to be returned, one per output node,
+   // to be compared to the calculatedOutputs
+   vecdo _expectedOutputs;
    
    // The alpha, or the learning rate, of the network.
    // The higher this value is, the more changes are allowed in the weights
@@ -42,16 +89,93 @@ private:
    // Changing this value may have impact on the training time.
    double _alpha;
    
-   // The output of the network. As of currently, this is only a single number,
-   // but later additions or experiments might require more outputs.
-   double _calculatedOutput;
+   // The outputs of the network, one per output node, before the final
+   // sigmoid. Related targets share all hidden nodes this way.
+   vecdo _calculatedOutputs;
    
    // The scheme according to which the weights of the network are initialised.
    // To better understand this, please read the accompanying paper.
    std::string _scheme;
+   
+   // The amount of times a node had a value in the flat part of the sigmoid,
+   // and the amount of times the output was NaN or infinite, since the
+   // network was made.
+   uint64_t _saturated = 0;
+   uint64_t _nonFinite = 0;
+   
+   // The activation function of the hidden nodes.
+   Activation::Type _activation = Activation::SIGMOID;
+   
+   // Decides how the weights are updated during training.
+   Optimizer _optimizer;
+   
+   // The state the optimizer keeps for each weight: the velocity or first
+   // moment, and the second moment. Empty when the optimizer does not
+   // need them.
+   WeightState _moments;
+   WeightState _variances;
+   
+   // The buffers of the threads used for training, kept between training
+   // steps. The first one is also used by train().
+   Workers _workers;
+   
+   // Whether the network has been pruned, and if so which weights are left.
+   bool _pruned = false;
+   SparseLayers _sparse;
+   
+   /* Helpers for training */
+   
+   // These choose the layer loops of the activation function,
+   // which are the ...With versions. outputs and expected hold a
+   // value per output node.
+   void propagate(const vecdo& inputs,
+                  vecvecdo& layers,
+                  vecvecdo& activations,
+                  double *outputs) const;
+   template < typename A >
+   void propagateWith(const vecdo& inputs,
+                      vecvecdo& layers,
+                      vecvecdo& activations,
+                      double *outputs) const;
+   template < typename A >
+   void forwardBatch(const vecvecdo& inputs,
+                     size_t begin,
+                     size_t end,
+                     double *outputs) const;
+   void checkHealth(const vecvecdo& layers,
+                    const double *outputs,
+                    uint64_t& saturated,
+                    uint64_t& nonFinite) const;
+   void backward(const double *expected,
+                 const vecvecdo& activations,
+                 const double *outputs,
+                 double *outputDeltas,
+                 vecvecdo& deltas,
+                 WeightState& directions) const;
+   template < typename A >
+   void backwardWith(const double *expected,
+                     const vecvecdo& activations,
+                     const double *outputs,
+                     double *outputDeltas,
+                     vecvecdo& deltas,
+                     WeightState& directions) const;
+   // Start an optimizer step and move the weights, see update()
+   void apply(const WeightState& directions, double scale);
+   // Move every weight along scale times its direction, within the
+   // optimizer step begun last
+   void update(const WeightState& directions, double scale);
+   
+   vecvecdo activationShape() const;
+   WeightState zeroState() const;
+   static void clear(WeightState& state);
+   static void add(WeightState& to, const WeightState& from);
+   std::vector< Worker >& workerBuffers(unsigned int amount);
 
 public:
    
+   // How trainBatch() combines the work of its threads
+   enum Parallel { DETERMINISTIC, HOGWILD };
+   
    Network(const vecdo& inputs,
            const vecvecdo& wFI,
            const vecvecdo& hL,
@@ -64,128 +188,201 @@ public:
            
    void initialiseWeights(uint16_t seed,
                           const vecdo& schemeWeights = {});
+   // Make the network like a new one of the same shape, with the
+   // weights of the seed or of the scheme weights, and forget all
+   // training. Everything is overwritten in place, so a network can
+   // be reused for job after job without allocating.
+   void reset(uint16_t seed,
+              const std::string& scheme,
+              const vecdo& schemeWeights = {});
+   // The reverse of initialiseWeights: for every position of the
+   // scheme weights, the weight it initialised.
+   vecdo schemeWeights() const;
    // Forward propagation for the network
    void forward();
+   // The outputs, before the final sigmoid, of the cases from begin up
+   // to end of inputs, amOutputNodes() per case. This leaves the
+   // network as it is, so multiple threads can do this at the same time.
+   void forward(const vecvecdo& inputs,
+                size_t begin,
+                size_t end,
+                double *outputs) const;
    // Backward propagation for the network
    // Also called training
    void train();
+   // One training step on a batch of cases, split over threads
+   void trainBatch(const vecvecdo& inputs,
+                   const vecdo& expected,
+                   unsigned int threads,
+                   Parallel mode = DETERMINISTIC);
+   // The same with the expected outputs of every output node per case
+   void trainBatch(const vecvecdo& inputs,
+                   const vecvecdo& expected,
+                   unsigned int threads,
+                   Parallel mode = DETERMINISTIC);
+           
+   // Zero all weights closer to 0 than threshold, and use sparse kernels
+   // for the layers with a density below cutoff.
+   void prune(double threshold, double cutoff = 0.5);
            
    /* Information callers */
 
-   uint16_t amInputNodes() const
-      { return static_cast<uint16_t>(_inputs.size()); }
-   uint16_t amHiddenNodes() const
-      { return static_cast<uint16_t>(_hiddenLayers[0].size()); }
-   uint16_t amHiddenLayers() const
-      { return static_cast<uint16_t>(_hiddenLayers.size()); }
-   uint16_t amOutputNodes() const { return 1; }
+   uint32_t amInputNodes() const
+      { return static_cast<uint32_t>(_inputs.size()); }
+   uint32_t amHiddenNodes() const
+      { return static_cast<uint32_t>(_hiddenLayers[0].size()); }
+   uint32_t amHiddenLayers() const
+      { return static_cast<uint32_t>(_hiddenLayers.size()); }
+   uint32_t amOutputNodes() const
+      { return static_cast<uint32_t>(_weightsToOutput[0].size()); }
    
    /* Getters */
    
    const vecdo&  inputs() const { return _inputs; }
-   const double& inputs(const uint16_t i) const
+   const double& inputs(const uint32_t i) const
    { return _inputs[i]; }
    
    const vecvecdo& weightsFromInputs() const
    { return _weightsFromInputs; }
-   const vecdo&    weightsFromInputs(const uint16_t i) const
+   const vecdo&    weightsFromInputs(const uint32_t i) const
    { return _weightsFromInputs[i]; }
-   const double&   weightsFromInputs(const uint16_t i, const uint16_t j) const
+   const double&   weightsFromInputs(const uint32_t i, const uint32_t j) const
    { return _weightsFromInputs[i][j]; }
    
    const vecvecdo& hiddenLayers() const
    { return _hiddenLayers; }
-   const vecdo&    hiddenLayers(const uint16_t i) const
+   const vecdo&    hiddenLayers(const uint32_t i) const
    { return _hiddenLayers[i]; }
-   const double&   hiddenLayers(const uint16_t i,
-                                const uint16_t j) const
+   const double&   hiddenLayers(const uint32_t i,
+                                const uint32_t j) const
    { return _hiddenLayers[i][j]; }
    
    const std::vector< vecvecdo >& weightsHiddenLayers() const
    { return _weightsHiddenLayers; }
-   const vecvecdo&                weightsHiddenLayers(const uint16_t i) const
+   const vecvecdo&                weightsHiddenLayers(const uint32_t i) const
    { return _weightsHiddenLayers[i]; }
-   const vecdo&                   weightsHiddenLayers(const uint16_t i,
-                                                      const uint16_t j) const
+   const vecdo&                   weightsHiddenLayers(const uint32_t i,
+                                                      const uint32_t j) const
    { return _weightsHiddenLayers[i][j]; }
-   const double&                  weightsHiddenLayers(const uint16_t i,
-                                                      const uint16_t j,
-                                                      const uint16_t k) const
+   const double&                  weightsHiddenLayers(const uint32_t i,
+                                                      const uint32_t j,
+                                                      const uint32_t k) const
    { return _weightsHiddenLayers[i][j][k]; }
    
    const vecvecdo& weightsToOutput() const
    { return _weightsToOutput; }
-   const vecdo&   weightsToOutput(const uint16_t i) const
+   const vecdo&   weightsToOutput(const uint32_t i) const
    { return _weightsToOutput[i]; }
-   const double&  weightsToOutput(const uint16_t i,
-                                  const uint16_t j) const
+   const double&  weightsToOutput(const uint32_t i,
+                                  const uint32_t j) const
    { return _weightsToOutput[i][j]; }
    
-   const double& expectedOutput() const { return _expectedOutput; }
+   // The first output, which is the only one for most tests
+   const double& expectedOutput() const { return _expectedOutputs[0]; }
+   const vecdo&  expectedOutputs() const { return _expectedOutputs; }
    
    const double& alpha() const { return _alpha; }
    
-   const double& calculatedOutput() const { return _calculatedOutput; }
+   const double& calculatedOutput() const { return _calculatedOutputs[0]; }
+   const vecdo&  calculatedOutputs() const { return _calculatedOutputs; }
    
    const std::string& scheme() const { return _scheme; }
    
+   const Optimizer& optimizer() const { return _optimizer; }
+   Activation::Type activation() const { return _activation; }
+   
+   uint64_t saturated() const { return _saturated; }
+   uint64_t nonFinite() const { return _nonFinite; }
+   // Once the output is not finite, training will not recover
+   bool diverged() const { return _nonFinite > 0; }
+   
+   bool pruned() const { return _pruned; }
+   double density() const;
+   double flopsSaved() const;
+   
    /* Setters */
    
    void inputs(const vecdo& a) { _inputs = a; }
-   void inputs(const uint16_t i, const double& a) { _inputs[i] = a; }
+   void inputs(const uint32_t i, const double& a) { _inputs[i] = a; }
    
    void weightsFromInputs(const vecvecdo& a)
    { _weightsFromInputs = a; }
-   void weightsFromInputs(const uint16_t i,
+   void weightsFromInputs(const uint32_t i,
                           const vecdo& a)
    { _weightsFromInputs[i] = a; }
-   void weightsFromInputs(const uint16_t i,
-                          const uint16_t j,
+   void weightsFromInputs(const uint32_t i,
+                          const uint32_t j,
                           const double& a)
    { _weightsFromInputs[i][j] = a; }
    
    void hiddenLayers(const vecvecdo& a)
    { _hiddenLayers = a; }
-   void hiddenLayers(const uint16_t i,
+   void hiddenLayers(const uint32_t i,
                      const vecdo& a)
    { _hiddenLayers[i] = a; }
-   void hiddenLayers(const uint16_t i,
-                     const uint16_t j,
+   void hiddenLayers(const uint32_t i,
+                     const uint32_t j,
                      const double& a)
    { _hiddenLayers[i][j] = a; }
    
    void weightsHiddenLayers(const std::vector< vecvecdo >& a)
    { _weightsHiddenLayers = a; }
-   void weightsHiddenLayers(const uint16_t i, const vecvecdo& a)
+   void weightsHiddenLayers(const uint32_t i, const vecvecdo& a)
    { _weightsHiddenLayers[i] = a; }
-   void weightsHiddenLayers(const uint16_t i,
-                            const uint16_t j,
+   void weightsHiddenLayers(const uint32_t i,
+                            const uint32_t j,
                             const vecdo& a)
    { _weightsHiddenLayers[i][j] = a; }
-   void weightsHiddenLayers(const uint16_t i,
-                            const uint16_t j,
-                            const uint16_t k,
+   void weightsHiddenLayers(const uint32_t i,
+                            const uint32_t j,
+                            const uint32_t k,
                             const double& a)
    { _weightsHiddenLayers[i][j][k] = a; }
    
    void weightsToOutput(const vecvecdo& a)
    { _weightsToOutput = a; }
-   void weightsToOutput(const uint16_t i, const vecdo& a)
+   void weightsToOutput(const uint32_t i, const vecdo& a)
    { _weightsToOutput[i] = a; }
-   void weightsToOutput(const uint16_t i,
-                        const uint16_t j,
+   void weightsToOutput(const uint32_t i,
+                        const uint32_t j,
                         const double& a)
    { _weightsToOutput[i][j] = a; }
    
-   void expectedOutput(const double& a) { _expectedOutput = a; }
+   void expectedOutput(const double& a) { _expectedOutputs[0] = a; }
+   void expectedOutputs(const vecdo& a) {
+      assert(a.size() == _expectedOutputs.size() && "Wrong amount of expected outputs!");
+      _expectedOutputs = a;
+   }
    
    void alpha(const double& a) { _alpha = a; }
    
-   void calculatedOutput(const double& a) { _calculatedOutput = a;}
+   void calculatedOutput(const double& a) { _calculatedOutputs[0] = a;}
    
    void scheme(const std::string& a) { _scheme = a; }
+   
+   // Also resets the state of the optimizer
+   void optimizer(const Optimizer& a);
+   void activation(const Activation::Type a) { _activation = a; }
 
    void writeDot(const std::string& filename);
+
+private:
+
+   // The training step of both trainBatch() versions, below Parallel.
+   // expected(c) gives the expected outputs of case c.
+   template < typename Expected >
+   void trainBatchWith(const vecvecdo& inputs,
+                       Expected expected,
+                       unsigned int threads,
+                       Parallel mode);
+
+   // Where a weight goes in the scheme weights: the input weights
+   // first, then the hidden layers, then the output weights. Every
+   // weight has a position of its own, out of schemeLength().
+   size_t schemeLength() const;
+   size_t inputPosition(uint32_t i, uint32_t h) const;
+   size_t hiddenPosition(uint32_t l, uint32_t hp, uint32_t hn) const;
+   size_t outputPosition(uint32_t h, uint32_t o) const;
 };
 
 #endif
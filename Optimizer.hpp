@@ -0,0 +1,184 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "Includes.hpp"
+
+class Optimizer {
+   /*
+    * Decides how a weight is changed, given the direction the
+    * backward propagation wants it to move in.
+    * Momentum and Nesterov keep a velocity per weight, Adam keeps
+    * a first and second moment per weight. This state is kept by
+    * the network, next to the weights themselves, and is passed
+    * to update() together with the weight.
+    */
+public:
+   enum Type { SGD, MOMENTUM, NESTEROV, ADAM };
+
+   Optimizer() = default;
+   Optimizer(const Type type,
+             const double beta1 = 0.9,
+             const double beta2 = 0.999,
+             const double epsilon = 1e-8)
+      : _type(type), _beta1(beta1), _beta2(beta2), _epsilon(epsilon) {}
+
+   // Parse the name of an optimizer. Returns false if it is unknown.
+   static bool parse(const std::string& name, Type& type) {
+      if (name == "sgd")           { type = SGD; }
+      else if (name == "momentum") { type = MOMENTUM; }
+      else if (name == "nesterov") { type = NESTEROV; }
+      else if (name == "adam")     { type = ADAM; }
+      else { return false; }
+      return true;
+   }
+
+   Type type() const { return _type; }
+   double beta1() const { return _beta1; }
+   void beta1(const double a) { _beta1 = a; }
+
+   // The amount of state values the optimizer keeps per weight.
+   uint8_t amState() const {
+      return _type == SGD ? 0 : (_type == ADAM ? 2 : 1);
+   }
+
+   // Forget the steps taken so far, as for a new network
+   void restart() {
+      _alpha = 0.0;
+      _step = 0;
+      _correction1 = 1.0;
+      _correction2 = 1.0;
+   }
+
+   void begin(const double alpha) {
+      /*
+       * Called once before every training step, so the bias
+       * corrections of Adam are not computed for every weight.
+       */
+      _alpha = alpha;
+      if (_type == ADAM) {
+         _step++;
+         _correction1 = correction(_beta1, _correction1);
+         _correction2 = correction(_beta2, _correction2);
+      }
+   }
+
+   inline void update(double& weight,
+                      const double direction,
+                      double& m,
+                      double& v) const {
+      /*
+       * Move weight along direction, which is minus the gradient
+       * of the error. m and v are the state of this weight.
+       */
+      switch (_type) {
+         case SGD:
+            weight += _alpha * direction;
+            break;
+         case MOMENTUM:
+            m = _beta1 * m + direction;
+            weight += _alpha * m;
+            break;
+         case NESTEROV:
+            m = _beta1 * m + direction;
+            weight += _alpha * (_beta1 * m + direction);
+            break;
+         case ADAM: {
+            m = _beta1 * m + (1.0 - _beta1) * direction;
+            v = _beta2 * v + (1.0 - _beta2) * direction * direction;
+            const double mHat = m / _correction1;
+            const double vHat = v / _correction2;
+            weight += _alpha * mHat / (std::sqrt(vHat) + _epsilon);
+            break;
+         }
+      }
+   }
+
+private:
+   double correction(const double beta, const double last) const {
+      /*
+       * 1 - beta^step. Once beta^step is below the precision of a
+       * double the correction is 1, and it stays 1, so pow() is no
+       * longer called. It would underflow after some thousands of
+       * steps and trip the floating point traps.
+       */
+      if (last == 1.0 && _step > 1) { return 1.0; }
+      const double decay = std::pow(beta, static_cast<double>(_step));
+      return decay < DBL_EPSILON ? 1.0 : 1.0 - decay;
+   }
+
+   Type _type = SGD;
+   double _beta1 = 0.9;
+   double _beta2 = 0.999;
+   double _epsilon = 1e-8;
+   double _alpha = 0.0;
+   uint64_t _step = 0;
+   double _correction1 = 1.0;
+   double _correction2 = 1.0;
+};
+
+class Schedule {
+   /*
+    * The learning rate as a function of the epoch.
+    * The rate can be constant, be multiplied by gamma every
+    * stepSize epochs, or follow half a cosine from alpha to 0
+    * over all epochs. Optionally, the rate increases linearly
+    * from 0 during the first warmup epochs.
+    */
+public:
+   enum Type { CONSTANT, STEP, COSINE };
+
+   Schedule() = default;
+   Schedule(const Type type,
+            const uint64_t warmup = 0,
+            const uint64_t stepSize = 0,
+            const double gamma = 0.5)
+      : _type(type), _warmup(warmup), _stepSize(stepSize), _gamma(gamma) {}
+
+   static bool parse(const std::string& name, Type& type) {
+      if (name == "constant")    { type = CONSTANT; }
+      else if (name == "step")   { type = STEP; }
+      else if (name == "cosine") { type = COSINE; }
+      else { return false; }
+      return true;
+   }
+
+   Type type() const { return _type; }
+   uint64_t warmup() const { return _warmup; }
+   void warmup(const uint64_t a) { _warmup = a; }
+   uint64_t stepSize() const { return _stepSize; }
+   void stepSize(const uint64_t a) { _stepSize = a; }
+   double gamma() const { return _gamma; }
+   void gamma(const double a) { _gamma = a; }
+
+   double alpha(const double base,
+                const uint64_t epoch,
+                const uint64_t epochs) const {
+      double rate = base;
+      switch (_type) {
+         case CONSTANT:
+            break;
+         case STEP: {
+            // Default to 4 steps over the whole run
+            const uint64_t size = _stepSize > 0 ? _stepSize :
+                                  std::max< uint64_t >(epochs / 4, 1);
+            rate *= std::pow(_gamma, static_cast<double>(epoch / size));
+            break;
+         }
+         case COSINE:
+            rate *= 0.5 * (1.0 + std::cos(M_PI * epoch / epochs));
+            break;
+      }
+      if (epoch < _warmup) {
+         rate *= static_cast<double>(epoch + 1) / (_warmup + 1);
+      }
+      return rate;
+   }
+
+private:
+   Type _type = CONSTANT;
+   uint64_t _warmup = 0;
+   uint64_t _stepSize = 0;
+   double _gamma = 0.5;
+};
+
+#endif
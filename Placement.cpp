@@ -0,0 +1,117 @@
+#include "Placement.hpp"
+
+bool Placement::parse(const std::string& name, Mode& mode) {
+   if (name == "none")      { mode = NONE; }
+   else if (name == "core") { mode = CORE; }
+   else if (name == "node") { mode = NODE; }
+   else { return false; }
+   return true;
+}
+
+std::string Placement::name(const Mode mode) {
+   switch (mode) {
+      case CORE: return "core";
+      case NODE: return "node";
+      default:   return "none";
+   }
+}
+
+namespace {
+   std::vector< uint32_t > parseCpuList(const std::string& list) {
+      // A list like "0-3,8-11"
+      std::vector< uint32_t > cpus;
+      std::istringstream ranges(list);
+      std::string range;
+      while (std::getline(ranges, range, ',')) {
+         unsigned int first = 0, last = 0;
+         const int read = sscanf(range.c_str(), "%u-%u", &first, &last);
+         if (read < 1) { continue; }
+         if (read == 1) { last = first; }
+         for (unsigned int c = first; c <= last; c++) { cpus.push_back(c); }
+      }
+      return cpus;
+   }
+}
+
+std::vector< Placement::Node > Placement::topology() {
+   cpu_set_t allowed;
+   CPU_ZERO(&allowed);
+   if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+      for (uint32_t c = 0; c < CPU_SETSIZE; c++) { CPU_SET(c, &allowed); }
+   }
+
+   std::vector< Node > nodes;
+   const std::string base = "/sys/devices/system/node/";
+   DIR *d = opendir(base.c_str());
+   if (d != nullptr) {
+      while (dirent *entry = readdir(d)) {
+         unsigned int id = 0;
+         char rest = '\0';
+         if (sscanf(entry->d_name, "node%u%c", &id, &rest) != 1) { continue; }
+         std::ifstream in(base + entry->d_name + "/cpulist");
+         std::string list;
+         std::getline(in, list);
+         Node node = {id, {}};
+         for (const uint32_t c : parseCpuList(list)) {
+            if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)) { node.cpus.push_back(c); }
+         }
+         // Nodes with only memory have no cpus to run on
+         if (!node.cpus.empty()) { nodes.push_back(node); }
+      }
+      closedir(d);
+   }
+   std::sort(nodes.begin(), nodes.end(),
+             [](const Node& a, const Node& b) { return a.id < b.id; });
+
+   if (nodes.empty()) {
+      Node node = {0, {}};
+      for (uint32_t c = 0; c < CPU_SETSIZE; c++) {
+         if (CPU_ISSET(c, &allowed)) { node.cpus.push_back(c); }
+      }
+      nodes.push_back(node);
+   }
+   return nodes;
+}
+
+int Placement::pin(const std::vector< Node >& nodes,
+                   const Mode mode,
+                   const uint32_t worker) {
+   /*
+    * The workers are spread over the nodes first, so all sockets
+    * are used even with few workers, and then over the cores of
+    * each node.
+    */
+   if (mode == NONE || nodes.empty()) { return -1; }
+   const Node& node = nodes[worker % nodes.size()];
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   if (mode == CORE) {
+      const auto index = (worker / nodes.size()) % node.cpus.size();
+      CPU_SET(node.cpus[index], &set);
+   } else {
+      for (const uint32_t c : node.cpus) { CPU_SET(c, &set); }
+   }
+   if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+      return -1;
+   }
+   return static_cast<int>(node.id);
+}
+
+std::string Placement::describe(const std::vector< Node >& nodes) {
+   std::string text = std::to_string(nodes.size()) +
+                      (nodes.size() == 1 ? " node:" : " nodes:");
+   for (const Node& node : nodes) {
+      text += " " + std::to_string(node.id) + "[";
+      // Write consecutive cpus as a range
+      for (size_t i = 0; i < node.cpus.size(); i++) {
+         size_t j = i;
+         while (j + 1 < node.cpus.size() && node.cpus[j + 1] == node.cpus[j] + 1) { j++; }
+         if (i > 0) { text += ","; }
+         text += std::to_string(node.cpus[i]);
+         if (j > i) { text += "-" + std::to_string(node.cpus[j]); }
+         i = j;
+      }
+      text += "]";
+   }
+   return text;
+}
@@ -0,0 +1,40 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+#include "Includes.hpp"
+
+namespace Placement {
+   /*
+    * Where the sweep workers run. Without placement the scheduler
+    * moves them freely between cores and sockets. With placement,
+    * worker w is bound to NUMA node w % (amount of nodes), either
+    * to a single core of that node or to all of its cores. As a
+    * worker allocates its own networks and data after it is bound,
+    * the kernel places that memory on its node (first touch).
+    */
+
+   enum Mode { NONE, CORE, NODE };
+
+   struct Node {
+      uint32_t id;
+      std::vector< uint32_t > cpus;
+   };
+
+   // Parse the name of a mode. Returns false if it is unknown.
+   bool parse(const std::string& name, Mode& mode);
+   std::string name(Mode mode);
+
+   // The NUMA nodes from /sys, each with the cpus of that node this
+   // process may run on. Without NUMA information all allowed cpus
+   // form a single node.
+   std::vector< Node > topology();
+
+   // Bind the calling thread to the cpus of the given worker.
+   // Returns the node it was bound to, or -1 if it was not bound.
+   int pin(const std::vector< Node >& nodes, Mode mode, uint32_t worker);
+
+   // Like "2 nodes: 0[0-7] 1[8-15]"
+   std::string describe(const std::vector< Node >& nodes);
+}
+
+#endif
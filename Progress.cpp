@@ -0,0 +1,199 @@
+#include "Progress.hpp"
+
+namespace {
+   // Index of the worker the current thread counts towards
+   thread_local uint32_t workerId = 0;
+}
+
+void Progress::start(const uint32_t workers,
+                     const uint64_t totalJobs,
+                     const uint64_t epochsPerJob) {
+   _amWorkers = workers > 0 ? workers : 1;
+   static_assert(sizeof(Counters) == 64, "The counters should fill 64 bytes");
+   void *memory = nullptr;
+   if (posix_memalign(&memory, alignof(Counters), _amWorkers * sizeof(Counters)) != 0) {
+      throw std::bad_alloc();
+   }
+   _workers.reset(static_cast<Counters *>(memory));
+   for (uint32_t w = 0; w < _amWorkers; w++) {
+      new (&_workers[w]) Counters();
+      _workers[w].jobs.store(0);
+      _workers[w].epochs.store(0);
+   }
+   _totalJobs = totalJobs;
+   _epochsPerJob = epochsPerJob;
+   _lastJobs = 0;
+   _lastEpochs = 0;
+   _diverged.store(0);
+   _start = std::chrono::steady_clock::now();
+}
+
+void Progress::report(const bool bar,
+                      const std::string& metricsFile/* = ""*/,
+                      const unsigned int interval/* = 5*/) {
+   _bar = bar;
+   _metricsFile = metricsFile;
+   _interval = interval > 0 ? interval : 1;
+   if (!_bar && _metricsFile.empty()) { return; }
+   _stop = false;
+   _reporter = std::thread(&Progress::reporter, this);
+}
+
+void Progress::stop() {
+   if (!_reporter.joinable()) { return; }
+   {
+      std::lock_guard< std::mutex > lock(_mutex);
+      _stop = true;
+   }
+   _stopped.notify_all();
+   _reporter.join();
+}
+
+void Progress::worker(const uint32_t id) {
+   workerId = id;
+}
+
+Progress::Counters& Progress::counters() {
+   return _workers[workerId % _amWorkers];
+}
+
+void Progress::addEpochs(const uint64_t epochs) {
+   if (_amWorkers == 0) { return; }
+   counters().epochs.fetch_add(epochs, std::memory_order_relaxed);
+}
+
+void Progress::finishJob() {
+   if (_amWorkers == 0) { return; }
+   counters().jobs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Progress::divergedJob() {
+   _diverged.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Progress::jobsDone() const {
+   uint64_t jobs = 0;
+   for (uint32_t w = 0; w < _amWorkers; w++) {
+      jobs += _workers[w].jobs.load(std::memory_order_relaxed);
+   }
+   return jobs;
+}
+
+uint64_t Progress::epochsDone() const {
+   uint64_t epochs = 0;
+   for (uint32_t w = 0; w < _amWorkers; w++) {
+      epochs += _workers[w].epochs.load(std::memory_order_relaxed);
+   }
+   return epochs;
+}
+
+double Progress::elapsed() const {
+   return std::chrono::duration< double >(
+             std::chrono::steady_clock::now() - _start).count();
+}
+
+Progress::Rates Progress::rates(const double interval) {
+   /*
+    * The rates are measured over the last interval, so they show
+    * the current speed of the sweep. The ETA uses the average over
+    * the whole sweep instead, as that is a lot more stable.
+    */
+   const uint64_t jobs = jobsDone();
+   const uint64_t epochs = epochsDone();
+   Rates r;
+   r.epochsPerSecond = (epochs - _lastEpochs) / interval;
+   r.schemesPerSecond = (jobs - _lastJobs) / interval;
+   _lastJobs = jobs;
+   _lastEpochs = epochs;
+
+   const double totalEpochs = static_cast<double>(_totalJobs * _epochsPerJob);
+   const double average = epochs / elapsed();
+   r.eta = average > 0.0 && totalEpochs > epochs ?
+           (totalEpochs - epochs) / average : 0.0;
+   return r;
+}
+
+void Progress::printBar(const Rates& r) const {
+   /*
+    * Print the progressbar, followed by the rates.
+    * The carriage return makes the next print overwrite it.
+    */
+   const double progress = _totalJobs > 0 ?
+                           static_cast<double>(jobsDone()) / _totalJobs : 0.0;
+   const int barWidth = 50;
+   const auto amountProg = static_cast<unsigned long>(barWidth * progress);
+
+   uint64_t minJobs = UINT64_MAX, maxJobs = 0;
+   for (uint32_t w = 0; w < _amWorkers; w++) {
+      const uint64_t jobs = _workers[w].jobs.load(std::memory_order_relaxed);
+      minJobs = std::min(minJobs, jobs);
+      maxJobs = std::max(maxJobs, jobs);
+   }
+
+   std::cout << "[" << std::string(amountProg, '#')
+             << std::string(barWidth - amountProg, ' ') << "] "
+             << int(progress * 100.0) << "% "
+             << General::to_string_prec(r.epochsPerSecond, 3) << " epochs/s "
+             << General::to_string_prec(r.schemesPerSecond, 3) << " schemes/s "
+             << "ETA " << static_cast<uint64_t>(r.eta) << "s "
+             << "jobs/worker " << minJobs << "-" << maxJobs << "   \r";
+   std::cout.flush();
+}
+
+void Progress::writeMetrics(const Rates& r) const {
+   /*
+    * Write a snapshot of the metrics in the Prometheus text format.
+    * It is written to a temporary file first and then renamed, so
+    * whoever scrapes it never sees a half written snapshot.
+    */
+   const std::string tmpFile = _metricsFile + ".tmp";
+   FILE *of = fopen(tmpFile.c_str(), "w");
+   if (of == nullptr) { return; }
+   fprintf(of, "dln_jobs_done %llu\n",
+           static_cast<unsigned long long>(jobsDone()));
+   fprintf(of, "dln_jobs_total %llu\n",
+           static_cast<unsigned long long>(_totalJobs));
+   fprintf(of, "dln_epochs_done %llu\n",
+           static_cast<unsigned long long>(epochsDone()));
+   fprintf(of, "dln_jobs_diverged %llu\n",
+           static_cast<unsigned long long>(jobsDiverged()));
+   fprintf(of, "dln_epochs_per_second %f\n", r.epochsPerSecond);
+   fprintf(of, "dln_schemes_per_second %f\n", r.schemesPerSecond);
+   fprintf(of, "dln_eta_seconds %f\n", r.eta);
+   fprintf(of, "dln_elapsed_seconds %f\n", elapsed());
+   for (uint32_t w = 0; w < _amWorkers; w++) {
+      fprintf(of, "dln_worker_jobs{worker=\"%u\"} %llu\n", w,
+              static_cast<unsigned long long>(
+                 _workers[w].jobs.load(std::memory_order_relaxed)));
+      fprintf(of, "dln_worker_epochs{worker=\"%u\"} %llu\n", w,
+              static_cast<unsigned long long>(
+                 _workers[w].epochs.load(std::memory_order_relaxed)));
+   }
+   fclose(of);
+   rename(tmpFile.c_str(), _metricsFile.c_str());
+}
+
+void Progress::reporter() {
+   /*
+    * Runs on its own thread until stop() is called. The bar is
+    * refreshed every second, the metrics every _interval seconds.
+    * A final report is done when stopping.
+    */
+   auto last = std::chrono::steady_clock::now();
+   unsigned int ticks = 0;
+   std::unique_lock< std::mutex > lock(_mutex);
+   while (true) {
+      const bool stopping = _stopped.wait_for(lock,
+                                              std::chrono::seconds(1),
+                                              [this] { return _stop; });
+      const auto now = std::chrono::steady_clock::now();
+      const Rates r = rates(std::chrono::duration< double >(now - last).count());
+      last = now;
+      ticks++;
+      if (_bar) { printBar(r); }
+      if (!_metricsFile.empty() && (stopping || ticks % _interval == 0)) {
+         writeMetrics(r);
+      }
+      if (stopping) { break; }
+   }
+}
@@ -0,0 +1,103 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include "Includes.hpp"
+
+#include "General.hpp"
+
+class Progress {
+   /*
+    * Keeps track of how far a sweep is, in a way which is safe to
+    * update from all the worker threads at once.
+    * Every worker only touches its own counters, the reporter
+    * thread sums them to print the progressbar and to write the
+    * metrics snapshots.
+    */
+public:
+
+   Progress() = default;
+   ~Progress() { stop(); }
+
+   Progress(const Progress&) = delete;
+   Progress& operator=(const Progress&) = delete;
+
+   // Reset the counters for a sweep of totalJobs jobs of
+   // epochsPerJob epochs each, spread over the given workers.
+   void start(uint32_t workers,
+              uint64_t totalJobs,
+              uint64_t epochsPerJob);
+
+   // Start the reporter thread. It prints the progressbar if bar is
+   // set and writes a metrics snapshot to metricsFile (if not empty)
+   // every interval seconds.
+   void report(bool bar,
+               const std::string& metricsFile = "",
+               unsigned int interval = 5);
+
+   // Stop the reporter thread and do a final report.
+   void stop();
+
+   // Bind the calling thread to the counters of the given worker.
+   static void worker(uint32_t id);
+
+   void addEpochs(uint64_t epochs);
+   void finishJob();
+   void divergedJob();
+
+   uint64_t jobsDone() const;
+   uint64_t epochsDone() const;
+   uint64_t jobsDiverged() const
+      { return _diverged.load(std::memory_order_relaxed); }
+   double elapsed() const;
+
+private:
+
+   struct alignas(64) Counters {
+      // Aligned and padded to its own cache line, so that workers do
+      // not slow each other down by writing to the same line.
+      std::atomic< uint64_t > jobs;
+      std::atomic< uint64_t > epochs;
+      char padding[64 - 2 * sizeof(std::atomic< uint64_t >)];
+   };
+
+   struct Rates {
+      double epochsPerSecond;
+      double schemesPerSecond;
+      double eta;
+   };
+
+   // The counters are allocated aligned to a cache line, which new
+   // does not do before C++17, so they are given back with free()
+   struct Free {
+      void operator()(Counters *counters) const { free(counters); }
+   };
+
+   Counters& counters();
+   Rates rates(double interval);
+   void printBar(const Rates& r) const;
+   void writeMetrics(const Rates& r) const;
+   void reporter();
+
+   std::unique_ptr< Counters[], Free > _workers;
+   uint32_t _amWorkers = 0;
+   uint64_t _totalJobs = 0;
+   uint64_t _epochsPerJob = 0;
+   // Rare enough to not need a counter per worker
+   std::atomic< uint64_t > _diverged{0};
+   std::chrono::steady_clock::time_point _start;
+
+   // The counts at the previous report, for the live rates
+   uint64_t _lastJobs = 0;
+   uint64_t _lastEpochs = 0;
+
+   bool _bar = false;
+   std::string _metricsFile;
+   unsigned int _interval = 5;
+
+   std::thread _reporter;
+   std::mutex _mutex;
+   std::condition_variable _stopped;
+   bool _stop = false;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "Quantised.hpp"
+
+const uint32_t QuantisedNetwork::tableSteps;
+constexpr double QuantisedNetwork::tableRange;
+
+QuantisedNetwork::Layer QuantisedNetwork::quantise(const vecvecdo& weights,
+                                                   const uint32_t rows,
+                                                   const uint32_t cols) {
+   /*
+    * Quantise the first rows x cols weights of a layer, with a
+    * scale such that the largest weight maps to 127. The row
+    * after those is the row of the bias node, which always has
+    * value -1, so it is kept as the (negated) bias of each column.
+    */
+   Layer layer;
+   layer.rows = rows;
+   layer.cols = cols;
+   double largest = 0.0;
+   for (uint32_t i = 0; i < rows; i++) {
+      for (uint32_t j = 0; j < cols; j++) {
+         largest = std::max(largest, std::fabs(weights[i][j]));
+      }
+   }
+   layer.scale = largest > 0.0 ? largest / 127.0 : 1.0;
+   layer.weights.resize(static_cast<size_t>(rows) * cols);
+   for (uint32_t i = 0; i < rows; i++) {
+      for (uint32_t j = 0; j < cols; j++) {
+         layer.weights[static_cast<size_t>(j) * rows + i] =
+            static_cast<int8_t>(std::lround(weights[i][j] / layer.scale));
+      }
+   }
+   layer.bias.resize(cols);
+   for (uint32_t j = 0; j < cols; j++) { layer.bias[j] = -weights[rows][j]; }
+   return layer;
+}
+
+QuantisedNetwork::QuantisedNetwork(const Network& n) {
+   assert(supports(n.activation()) && "Activation can not be quantised!");
+   const auto hiddenLayers = n.amHiddenLayers();
+   const auto inputNodes   = n.amInputNodes();
+   const auto hiddenNodes  = n.amHiddenNodes();
+
+   // The bias node of the hidden layers is left out of the columns,
+   // as its value is never used.
+   _layers.push_back(quantise(n.weightsFromInputs(),
+                              inputNodes - 1, hiddenNodes - 1));
+   for (uint32_t l = 0; l + 1 < hiddenLayers; l++) {
+      _layers.push_back(quantise(n.weightsHiddenLayers(l),
+                                 hiddenNodes - 1, hiddenNodes - 1));
+   }
+   _layers.push_back(quantise(n.weightsToOutput(), hiddenNodes - 1, 1));
+
+   _sigmoid = table(Activation::SIGMOID).data();
+   _activation = table(n.activation()).data();
+}
+
+const std::vector< uint8_t >& QuantisedNetwork::table(const Activation::Type activation) {
+   // Each is filled once, the first time it is needed
+   const auto fill = [](const Activation::Type a) {
+      std::vector< uint8_t > t(tableSteps);
+      for (uint32_t s = 0; s < tableSteps; s++) {
+         const double x = -tableRange + s * (2.0 * tableRange / (tableSteps - 1));
+         t[s] = static_cast<uint8_t>(std::lround(255.0 * Activation::f(a, x)));
+      }
+      return t;
+   };
+   static const std::vector< uint8_t > sigmoid = fill(Activation::SIGMOID);
+   static const std::vector< uint8_t > hardSigmoid = fill(Activation::HARDSIGMOID);
+   return activation == Activation::HARDSIGMOID ? hardSigmoid : sigmoid;
+}
+
+double QuantisedNetwork::forward(const vecdo& inputs) const {
+   /*
+    * Forward propagation with integer products. The buffers are
+    * kept per thread, so no allocations are done after the first
+    * call of a thread.
+    */
+   thread_local std::vector< int16_t > activations, next;
+   thread_local std::vector< int32_t > sums;
+
+   activations.resize(inputs.size() - 1);
+   for (size_t i = 0; i + 1 < inputs.size(); i++) {
+      activations[i] = lookup(_sigmoid, inputs[i]);
+   }
+
+   double output = 0.0;
+   for (size_t l = 0; l < _layers.size(); l++) {
+      const Layer& layer = _layers[l];
+      sums.resize(layer.cols);
+      // Plain pointers, so the compiler can vectorise the inner loop.
+      // Summing 16 bit products into 32 bits is done 8 at a time
+      // by a single instruction (pmaddwd), even without SSE4.
+      const int16_t *__restrict in = activations.data();
+      const uint32_t rows = layer.rows;
+      for (uint32_t j = 0; j < layer.cols; j++) {
+         const int8_t *__restrict column =
+            layer.weights.data() + static_cast<size_t>(j) * rows;
+         int32_t sum = 0;
+         for (uint32_t i = 0; i < rows; i++) {
+            sum += static_cast<int32_t>(static_cast<int16_t>(column[i])) *
+                   static_cast<int32_t>(in[i]);
+         }
+         sums[j] = sum;
+      }
+      // The sums are in units of scale / 255
+      const double unit = layer.scale / 255.0;
+      if (l + 1 == _layers.size()) {
+         output = sums[0] * unit + layer.bias[0];
+         break;
+      }
+      next.resize(layer.cols);
+      for (uint32_t j = 0; j < layer.cols; j++) {
+         next[j] = lookup(_activation, sums[j] * unit + layer.bias[j]);
+      }
+      activations.swap(next);
+   }
+   return output;
+}
+
+size_t QuantisedNetwork::bytes() const {
+   size_t total = 0;
+   for (const Layer& layer : _layers) {
+      total += layer.weights.size() + layer.bias.size() * sizeof(double);
+   }
+   return total;
+}
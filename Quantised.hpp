@@ -0,0 +1,72 @@
+#ifndef QUANTISED_HPP
+#define QUANTISED_HPP
+
+#include "Includes.hpp"
+
+#include "General.hpp"
+#include "Network.hpp"
+
+class QuantisedNetwork {
+   /*
+    * A trained network converted for fast inference only.
+    * Every layer of weights is stored as 8 bit integers with one
+    * scale per layer, the activations of the nodes as integers
+    * from 0 to 255 in steps of 1/255, and the activation itself
+    * is looked up in a table. This only works for activations
+    * between 0 and 1, see supports(). The products of a layer are summed up in
+    * 32 bit integers, only the bias weights stay doubles.
+    */
+public:
+
+   explicit QuantisedNetwork(const Network& n);
+
+   // Whether networks with this activation can be quantised
+   static bool supports(Activation::Type activation) {
+      return activation == Activation::SIGMOID ||
+             activation == Activation::HARDSIGMOID;
+   }
+
+   // The output of the network for the given inputs, before the
+   // final sigmoid, like Network::calculatedOutput().
+   // Safe to call from multiple threads at once.
+   double forward(const vecdo& inputs) const;
+
+   // The amount of bytes the weights take up, the sigmoid table
+   // is shared by all networks.
+   size_t bytes() const;
+
+private:
+
+   struct Layer {
+      std::vector< int8_t > weights; // rows x cols, stored per column
+      vecdo bias;                    // what the bias node adds to each column
+      uint32_t rows;
+      uint32_t cols;
+      double scale;                  // a weight is scale times its integer
+   };
+
+   // The tables cover the activations on [-tableRange, tableRange],
+   // outside of it they are 0 or 1 within a step of 1/255.
+   static const uint32_t tableSteps = 4096;
+   static constexpr double tableRange = 8.0;
+
+   static const std::vector< uint8_t >& table(Activation::Type activation);
+
+   static Layer quantise(const vecvecdo& weights,
+                         uint32_t rows,
+                         uint32_t cols);
+
+   static uint8_t lookup(const uint8_t *table, const double x) {
+      const double position = (x + tableRange) *
+                              ((tableSteps - 1) / (2.0 * tableRange));
+      if (!(position > 0.0)) { return table[0]; }
+      if (position >= tableSteps - 1) { return table[tableSteps - 1]; }
+      return table[static_cast<uint32_t>(position + 0.5)];
+   }
+
+   std::vector< Layer > _layers;
+   const uint8_t *_sigmoid;    // for the inputs
+   const uint8_t *_activation; // for the hidden nodes
+};
+
+#endif
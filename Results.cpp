@@ -0,0 +1,32 @@
+#include "Results.hpp"
+
+bool Results::open(const std::string& file, const std::string& columns) {
+   close();
+   _rows = 0;
+   _file = file.empty() ? stdout : fopen(file.c_str(), "w");
+   if (_file == nullptr) {
+      fprintf(stderr, "Could not write the results to %s!\n", file.c_str());
+      return false;
+   }
+   fprintf(_file, "# %s error\n", columns.c_str());
+   return true;
+}
+
+void Results::append(const std::string& row, const double error) {
+   std::lock_guard< std::mutex > lock(_mutex);
+   if (_file == nullptr) { return; }
+   // The same precision as the result files
+   fprintf(_file, "%s %g\n", row.c_str(), error);
+   _rows++;
+}
+
+void Results::close() {
+   std::lock_guard< std::mutex > lock(_mutex);
+   if (_file == nullptr) { return; }
+   if (_file == stdout) {
+      fflush(_file);
+   } else {
+      fclose(_file);
+   }
+   _file = nullptr;
+}
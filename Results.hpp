@@ -0,0 +1,39 @@
+#ifndef RESULTS_HPP
+#define RESULTS_HPP
+
+#include "Includes.hpp"
+
+class Results {
+   /*
+    * A single file which all the results of a sweep go to, one row
+    * per result, instead of a file per configuration and scheme.
+    * The file stays open during the sweep and the rows are written
+    * under a lock, so rows of different threads never mix.
+    */
+public:
+
+   Results() = default;
+   ~Results() { close(); }
+
+   Results(const Results&) = delete;
+   Results& operator=(const Results&) = delete;
+
+   // Start the file with a header line naming the columns. An empty
+   // file name writes the rows to the terminal instead.
+   bool open(const std::string& file, const std::string& columns);
+
+   // Write a row, the error is added as the last column.
+   void append(const std::string& row, double error);
+
+   void close();
+
+   uint64_t rows() const { return _rows; }
+
+private:
+
+   FILE *_file = nullptr;
+   std::mutex _mutex;
+   uint64_t _rows = 0;
+};
+
+#endif
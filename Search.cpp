@@ -0,0 +1,172 @@
+#include "Search.hpp"
+
+Search::Search(const uint64_t length, Fitness fitness, const unsigned int seed)
+   : _length(length), _fitness(std::move(fitness)), _random(seed) {}
+
+void Search::canonical(Catalogue::Labels& labels) {
+   std::map< uint32_t, uint32_t > renamed;
+   for (uint32_t& l : labels) {
+      l = renamed.emplace(l, static_cast<uint32_t>(renamed.size())).first->second;
+   }
+}
+
+double Search::partitions(const uint64_t length) {
+   // The Bell triangle, every row starts with the end of the row before
+   std::vector< double > row = {1.0};
+   for (uint64_t i = 1; i < length; i++) {
+      std::vector< double > next = {row.back()};
+      for (const double x : row) { next.push_back(next.back() + x); }
+      row = next;
+   }
+   return row.back();
+}
+
+void Search::step(Catalogue::Labels& labels) {
+   /*
+    * Change the scheme by one random step, which is only a step if
+    * it gives another scheme. Needs at least two weights.
+    */
+   const uint32_t groups = *std::max_element(labels.begin(), labels.end()) + 1;
+   std::vector< uint32_t > sizes(groups, 0);
+   for (const uint32_t l : labels) { sizes[l]++; }
+   const bool splittable = std::any_of(sizes.begin(), sizes.end(),
+                                       [](const uint32_t s) { return s > 1; });
+   const auto pick = [this](const uint64_t amount) {
+      return std::uniform_int_distribution< uint64_t >(0, amount - 1)(_random);
+   };
+
+   Catalogue::Labels next;
+   do {
+      next = labels;
+      switch (pick(3)) {
+         case 0: {
+            // Move a weight to another group, or to a group of its own
+            const uint64_t w = pick(_length);
+            uint32_t to = static_cast<uint32_t>(pick(groups));
+            if (to == next[w]) { to = groups; }
+            next[w] = to;
+            break;
+         }
+         case 1: {
+            if (groups < 2) { continue; }
+            const auto a = static_cast<uint32_t>(pick(groups));
+            auto b = static_cast<uint32_t>(pick(groups - 1));
+            if (b >= a) { b++; }
+            std::replace(next.begin(), next.end(), b, a);
+            break;
+         }
+         default: {
+            if (!splittable) { continue; }
+            // Half of the weights of a group go to a new one
+            uint32_t g;
+            do { g = static_cast<uint32_t>(pick(groups)); } while (sizes[g] < 2);
+            for (uint32_t& l : next) {
+               if (l == g && pick(2) == 0) { l = groups; }
+            }
+            break;
+         }
+      }
+      canonical(next);
+   } while (next == labels);
+   labels = next;
+}
+
+double Search::error(const Catalogue::Labels& labels) {
+   const auto known = _errors.find(labels);
+   if (known != _errors.end()) {
+      _remembered++;
+      return known->second;
+   }
+   double e = _fitness(labels);
+   // A diverged run is as bad as it gets
+   if (!std::isfinite(e)) { e = HUGE_VAL; }
+   _errors.emplace(labels, e);
+   return e;
+}
+
+Catalogue::Labels Search::randomScheme() {
+   Catalogue::Labels labels(_length, 0);
+   uint32_t groups = 0;
+   for (uint32_t& l : labels) {
+      l = std::uniform_int_distribution< uint32_t >(0, groups)(_random);
+      groups = std::max(groups, l + 1);
+   }
+   return labels;
+}
+
+void Search::enumerate() {
+   /*
+    * Every canonical scheme in order, each label at most one more
+    * than the largest label before it.
+    */
+   Catalogue::Labels labels(_length, 0);
+   while (true) {
+      error(labels);
+      // The last label which can still grow
+      size_t i = _length - 1;
+      while (i > 0 && labels[i] > *std::max_element(labels.begin(),
+                                                    labels.begin() + static_cast<long>(i))) {
+         i--;
+      }
+      if (i == 0) { return; }
+      labels[i]++;
+      std::fill(labels.begin() + static_cast<long>(i) + 1, labels.end(), 0);
+   }
+}
+
+void Search::anneal(const uint64_t budget, const double start, const double end) {
+   if (_length < 2 || static_cast<double>(budget) >= partitions(_length)) {
+      // The budget buys every scheme, no need to search
+      enumerate();
+      return;
+   }
+
+   Catalogue::Labels current = randomScheme();
+   double currentError = error(current);
+
+   std::uniform_real_distribution< double > chance(0.0, 1.0);
+   // Once the neighbourhood of the current scheme is all known the
+   // steps go round in circles, start again somewhere else.
+   const uint64_t stuck = 10 * _length;
+   uint64_t known = 0;
+   // Steps to known schemes train nothing, so they need a limit
+   const uint64_t maxSteps = 100 * budget;
+   for (uint64_t s = 0; trained() < budget && s < maxSteps; s++) {
+      // Cools down as the budget is used
+      const double temperature = start * std::pow(end / start,
+                                                  static_cast<double>(trained()) / budget);
+      Catalogue::Labels next = current;
+      if (known >= stuck) {
+         next = randomScheme();
+         known = 0;
+      } else {
+         step(next);
+      }
+      const uint64_t before = trained();
+      const double e = error(next);
+      known = trained() > before ? 0 : known + 1;
+      _steps++;
+      bool take = e <= currentError;
+      if (!take && std::isfinite(e)) {
+         // exp() of a large negative number underflows, which traps
+         const double drop = (currentError - e) / temperature;
+         take = drop > -700.0 && chance(_random) < std::exp(drop);
+      }
+      if (take) {
+         current = next;
+         currentError = e;
+      }
+   }
+}
+
+std::vector< Search::Result > Search::best(const size_t amount) const {
+   std::vector< Result > results;
+   for (const auto& known : _errors) { results.push_back({known.first, known.second}); }
+   const size_t shown = std::min(amount, results.size());
+   std::partial_sort(results.begin(), results.begin() + static_cast<long>(shown),
+                     results.end(), [](const Result& a, const Result& b) {
+      return a.error < b.error;
+   });
+   results.resize(shown);
+   return results;
+}
@@ -0,0 +1,69 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include "Includes.hpp"
+
+#include "Catalogue.hpp"
+
+class Search {
+   /*
+    * Looks for the schemes with the lowest error without training
+    * all of them. A scheme is a partition of the weights into groups
+    * which start with the same weight, and n weights have Bell(n)
+    * of those, far too many to try beyond a dozen weights.
+    * The search is simulated annealing. From the current scheme it
+    * takes a small step: moving a weight to another or a new group,
+    * merging two groups or splitting one. A step which lowers the
+    * error is always taken, one which raises it with a chance which
+    * shrinks as the temperature falls.
+    * The error of a scheme comes from the fitness function, usually
+    * a short training run, and is remembered, so no scheme is ever
+    * trained twice.
+    */
+public:
+
+   typedef std::function< double(const Catalogue::Labels&) > Fitness;
+
+   struct Result {
+      Catalogue::Labels labels;
+      double error;
+   };
+
+   Search(uint64_t length, Fitness fitness, unsigned int seed);
+
+   // Anneal until budget schemes have been trained, with the
+   // temperature falling geometrically from start to end. A budget
+   // of at least all schemes trains every one of them instead.
+   void anneal(uint64_t budget, double start, double end);
+
+   // The best schemes trained so far, lowest error first
+   std::vector< Result > best(size_t amount) const;
+
+   uint64_t trained() const { return _errors.size(); }
+   uint64_t steps() const { return _steps; }
+   // Steps to a scheme which was trained before
+   uint64_t remembered() const { return _remembered; }
+
+   // Relabel a scheme in order of first appearance, so every
+   // partition is written in exactly one way.
+   static void canonical(Catalogue::Labels& labels);
+
+   // The amount of schemes of the given length (the Bell number)
+   static double partitions(uint64_t length);
+
+private:
+
+   Catalogue::Labels randomScheme();
+   void enumerate();
+   void step(Catalogue::Labels& labels);
+   double error(const Catalogue::Labels& labels);
+
+   uint64_t _length;
+   Fitness _fitness;
+   std::mt19937 _random;
+   std::map< Catalogue::Labels, double > _errors;
+   uint64_t _steps = 0;
+   uint64_t _remembered = 0;
+};
+
+#endif
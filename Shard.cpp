@@ -0,0 +1,181 @@
+#include "Shard.hpp"
+
+#include "General.hpp"
+
+bool Shard::parse(const std::string& text, Spec& spec) {
+   unsigned int index = 0, count = 0;
+   char rest = '\0';
+   if (sscanf(text.c_str(), "%u/%u%c", &index, &count, &rest) != 2 ||
+       count == 0 || index >= count) {
+      return false;
+   }
+   spec.index = index;
+   spec.count = count;
+   return true;
+}
+
+std::string Shard::folder(const std::string& base, const Spec& spec) {
+   if (spec.count == 0) { return base; }
+   return base + "shard" + std::to_string(spec.index) +
+          "of" + std::to_string(spec.count) + "/";
+}
+
+std::string Shard::status(const std::string& base, const Spec& spec) {
+   FILE *of = fopen((folder(base, spec) + "status").c_str(), "r");
+   if (of == nullptr) { return "pending"; }
+   char state[16] = {0};
+   if (fscanf(of, "%15s", state) != 1) { state[0] = '\0'; }
+   fclose(of);
+   return state[0] == '\0' ? "pending" : state;
+}
+
+void Shard::status(const std::string& base,
+                   const Spec& spec,
+                   const std::string& state) {
+   FILE *of = General::openFile(folder(base, spec) + "status");
+   fprintf(of, "%s\n", state.c_str());
+   fclose(of);
+}
+
+namespace {
+   void writeManifest(const int argc,
+                      char **argv,
+                      const uint32_t count,
+                      const std::string& base) {
+      /*
+       * The manifest lists every shard with its status and folder,
+       * together with the command the sweep was started with.
+       */
+      FILE *of = General::openFile(base + "manifest");
+      fprintf(of, "# dln sweep manifest\n");
+      fprintf(of, "shards %u\n", count);
+      fprintf(of, "command");
+      for (int a = 0; a < argc; a++) { fprintf(of, " %s", argv[a]); }
+      fprintf(of, "\n");
+      for (uint32_t i = 0; i < count; i++) {
+         const Shard::Spec spec = {i, count};
+         fprintf(of, "shard %u %s %s\n", i,
+                 Shard::status(base, spec).c_str(),
+                 Shard::folder(base, spec).c_str());
+      }
+      fclose(of);
+   }
+}
+
+uint32_t Shard::launch(const int argc,
+                       char **argv,
+                       const uint32_t count,
+                       const std::string& base) {
+   /*
+    * Every shard which is not done yet is started as a child
+    * process, which runs this same program with the original
+    * arguments and --shard i/N appended. Then wait for all of
+    * them, and merge the results when every shard is done.
+    */
+   __attribute__((unused)) const auto unused =
+               static_cast<uint16_t>(system(("mkdir -p " + base +
+                                             " 2> /dev/null").c_str()));
+   writeManifest(argc, argv, count, base);
+
+   std::vector< pid_t > children;
+   for (uint32_t i = 0; i < count; i++) {
+      const Spec spec = {i, count};
+      if (status(base, spec) == "done") { continue; }
+
+      const std::string shardArg = std::to_string(i) + "/" +
+                                   std::to_string(count);
+      std::vector< char* > args(argv, argv + argc);
+      args.push_back(const_cast<char*>("--shard"));
+      args.push_back(const_cast<char*>(shardArg.c_str()));
+      args.push_back(nullptr);
+
+      const pid_t pid = fork();
+      if (pid == 0) {
+         execv("/proc/self/exe", args.data());
+         fprintf(stderr, "Could not start shard %u!\n", i);
+         _exit(127);
+      }
+      if (pid < 0) {
+         fprintf(stderr, "Could not fork for shard %u!\n", i);
+         continue;
+      }
+      children.push_back(pid);
+   }
+
+   for (const pid_t child : children) {
+      int childStatus = 0;
+      waitpid(child, &childStatus, 0);
+   }
+
+   uint32_t failed = 0;
+   for (uint32_t i = 0; i < count; i++) {
+      const Spec spec = {i, count};
+      if (status(base, spec) != "done") {
+         fprintf(stderr, "Shard %u/%u did not finish, run again to retry it.\n",
+                 i, count);
+         failed++;
+      }
+   }
+   writeManifest(argc, argv, count, base);
+   if (failed == 0) { merge(base, count); }
+   return failed;
+}
+
+namespace {
+   std::vector< std::string > listFiles(const std::string& dir) {
+      std::vector< std::string > files;
+      DIR *d = opendir(dir.c_str());
+      if (d == nullptr) { return files; }
+      while (dirent *entry = readdir(d)) {
+         const std::string name = entry->d_name;
+         if (name == "." || name == ".." || name == "status") { continue; }
+         files.push_back(name);
+      }
+      closedir(d);
+      return files;
+   }
+
+   long seedOfLine(const std::string& line) {
+      // Lines written by a seed test start with "seed: <seed>,"
+      long seed = -1;
+      if (sscanf(line.c_str(), "seed: %ld,", &seed) != 1) { return -1; }
+      return seed;
+   }
+}
+
+bool Shard::merge(const std::string& base, const uint32_t count) {
+   std::set< std::string > names;
+   for (uint32_t i = 0; i < count; i++) {
+      const Spec spec = {i, count};
+      if (status(base, spec) != "done") {
+         fprintf(stderr, "Shard %u/%u is not done, not merging.\n", i, count);
+         return false;
+      }
+      for (const std::string& name : listFiles(folder(base, spec))) {
+         names.insert(name);
+      }
+   }
+
+   for (const std::string& name : names) {
+      std::vector< std::pair< long, std::string > > lines;
+      for (uint32_t i = 0; i < count; i++) {
+         const Spec spec = {i, count};
+         std::ifstream in(folder(base, spec) + name);
+         std::string line;
+         while (std::getline(in, line)) {
+            lines.emplace_back(seedOfLine(line), line);
+         }
+      }
+      std::stable_sort(lines.begin(), lines.end(),
+                       [](const std::pair< long, std::string >& a,
+                          const std::pair< long, std::string >& b) {
+                          return a.first < b.first;
+                       });
+      FILE *of = General::openFile(base + name);
+      for (const auto& line : lines) { fprintf(of, "%s\n", line.second.c_str()); }
+      fclose(of);
+   }
+   printf("Merged %u shards into %s (%lu files).\n",
+          count, base.c_str(), static_cast<unsigned long>(names.size()));
+   return true;
+}
@@ -0,0 +1,54 @@
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#include "Includes.hpp"
+
+namespace Shard {
+   /*
+    * Splitting a sweep over several processes.
+    * The jobs of a sweep, every (seed, scheme) pair, are numbered
+    * seed-major over the sorted schemes, and job j belongs to
+    * shard j % count. Every shard writes to its own folder and
+    * keeps a status file there, so a failed shard can be rerun
+    * on its own. Afterwards the shard folders are merged into
+    * the folder of the sweep.
+    */
+
+   struct Spec {
+      uint32_t index;
+      uint32_t count; // 0 means the sweep is not sharded
+   };
+
+   // Parse "i/N" into spec. Returns false if it is malformed.
+   bool parse(const std::string& text, Spec& spec);
+
+   inline bool owns(const Spec& spec, const uint64_t job) {
+      return spec.count == 0 || job % spec.count == spec.index;
+   }
+
+   // The folder the given shard writes its results to.
+   std::string folder(const std::string& base, const Spec& spec);
+
+   // The status of a shard: "pending", "running" or "done".
+   std::string status(const std::string& base, const Spec& spec);
+   void status(const std::string& base,
+               const Spec& spec,
+               const std::string& state);
+
+   // Run every shard which is not done yet as a separate process
+   // running this program with the same arguments plus --shard i/N.
+   // Writes the manifest, and merges the shards once all are done.
+   // Returns the amount of shards which failed.
+   uint32_t launch(int argc,
+                   char **argv,
+                   uint32_t count,
+                   const std::string& base);
+
+   // Merge the results of all count shards into base.
+   // The lines of equally named files are concatenated and
+   // sorted by seed, so the result does not depend on the
+   // order in which the jobs were run.
+   bool merge(const std::string& base, uint32_t count);
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "Statistics.hpp"
+
+namespace {
+   // Lower mean error first, the scheme decides between equal means
+   bool better(const Statistics::Entry& a, const Statistics::Entry& b) {
+      if (a.running.mean != b.running.mean) { return a.running.mean < b.running.mean; }
+      return a.scheme < b.scheme;
+   }
+
+   void writeEntry(FILE *of, const Statistics::Entry& e) {
+      fprintf(of, "%s %llu %g %g %g %g %llu\n", e.scheme.c_str(),
+              static_cast<unsigned long long>(e.running.count), e.running.mean,
+              std::sqrt(e.running.variance()), e.running.min, e.running.max,
+              static_cast<unsigned long long>(e.running.diverged));
+   }
+}
+
+void Statistics::Running::add(const double error) {
+   if (!std::isfinite(error)) {
+      diverged++;
+      return;
+   }
+   count++;
+   const double delta = error - mean;
+   mean += delta / count;
+   m2 += delta * (error - mean);
+   min = std::min(min, error);
+   max = std::max(max, error);
+}
+
+void Statistics::add(const std::string& scheme, const double error) {
+   Shard& s = shard(scheme);
+   std::lock_guard< std::mutex > lock(s.mutex);
+   s.schemes[scheme].add(error);
+}
+
+uint64_t Statistics::schemes() const {
+   uint64_t amount = 0;
+   for (const Shard& s : _shards) {
+      std::lock_guard< std::mutex > lock(s.mutex);
+      amount += s.schemes.size();
+   }
+   return amount;
+}
+
+std::vector< Statistics::Entry > Statistics::leaders(const size_t amount,
+                                                     const bool lowest) const {
+   /*
+    * A heap of at most amount entries, with the one which would
+    * drop out first on top, so the table is gone through once
+    * without sorting all of it.
+    */
+   const auto order = [lowest](const Entry& a, const Entry& b) {
+      return lowest ? better(a, b) : better(b, a);
+   };
+   if (amount == 0) { return {}; }
+   std::priority_queue< Entry, std::vector< Entry >, decltype(order) > heap(order);
+   for (const Shard& s : _shards) {
+      std::lock_guard< std::mutex > lock(s.mutex);
+      for (const auto& scheme : s.schemes) {
+         if (scheme.second.count == 0) { continue; }
+         const Entry e = {scheme.first, scheme.second};
+         if (heap.size() < amount) {
+            heap.push(e);
+         } else if (order(e, heap.top())) {
+            heap.pop();
+            heap.push(e);
+         }
+      }
+   }
+   std::vector< Entry > entries(heap.size());
+   for (size_t i = entries.size(); i > 0; i--) {
+      entries[i - 1] = heap.top();
+      heap.pop();
+   }
+   return entries;
+}
+
+bool Statistics::write(const std::string& file, const size_t amount) const {
+   FILE *of = file.empty() ? stdout : fopen(file.c_str(), "w");
+   if (of == nullptr) {
+      fprintf(stderr, "Could not write the statistics to %s!\n", file.c_str());
+      return false;
+   }
+   const char *columns = "scheme seeds mean stddev min max diverged";
+   const std::vector< Entry > best = leaders(amount, true);
+   fprintf(of, "# best %zu by mean error\n# %s\n", best.size(), columns);
+   for (const Entry& e : best) { writeEntry(of, e); }
+   const std::vector< Entry > worst = leaders(amount, false);
+   fprintf(of, "# worst %zu by mean error\n# %s\n", worst.size(), columns);
+   for (const Entry& e : worst) { writeEntry(of, e); }
+
+   // All schemes, in the order of their names
+   std::vector< Entry > all;
+   for (const Shard& s : _shards) {
+      std::lock_guard< std::mutex > lock(s.mutex);
+      for (const auto& scheme : s.schemes) { all.push_back({scheme.first, scheme.second}); }
+   }
+   std::sort(all.begin(), all.end(), [](const Entry& a, const Entry& b) {
+      return a.scheme < b.scheme;
+   });
+   fprintf(of, "# all %zu schemes\n# %s\n", all.size(), columns);
+   for (const Entry& e : all) { writeEntry(of, e); }
+
+   const bool written = ferror(of) == 0;
+   if (of == stdout) {
+      fflush(of);
+   } else {
+      fclose(of);
+   }
+   if (!written) { fprintf(stderr, "Could not write the statistics to %s!\n", file.c_str()); }
+   return written;
+}
@@ -0,0 +1,72 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include "Includes.hpp"
+
+class Statistics {
+   /*
+    * Running statistics of the final error of every scheme over the
+    * seeds it was trained with, kept while the sweep goes on, so
+    * the leaders are known without going through the result files
+    * afterwards.
+    * The mean and variance are updated with Welford's method, which
+    * needs neither the errors themselves nor a second pass.
+    * The schemes are spread over shards with a lock each, so the
+    * evaluator threads rarely wait for each other.
+    */
+public:
+
+   struct Running {
+      uint64_t count = 0;
+      uint64_t diverged = 0; // runs which ended in a NaN or inf
+      double mean = 0.0;
+      double m2 = 0.0; // sum of squared differences from the mean
+      double min = HUGE_VAL;
+      double max = -HUGE_VAL;
+
+      void add(double error);
+      // The sample variance, 0 below two errors
+      double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+   };
+
+   struct Entry {
+      std::string scheme;
+      Running running;
+   };
+
+   Statistics() = default;
+
+   Statistics(const Statistics&) = delete;
+   Statistics& operator=(const Statistics&) = delete;
+
+   // Add the final error of a run of the scheme, from any thread.
+   void add(const std::string& scheme, double error);
+
+   uint64_t schemes() const;
+
+   // The amount schemes with the lowest (or highest) mean error,
+   // best first (or worst first). Schemes of which every run
+   // diverged are left out.
+   std::vector< Entry > leaders(size_t amount, bool lowest = true) const;
+
+   // Write the best and worst amount schemes and then all schemes.
+   // An empty file name writes to the terminal instead.
+   bool write(const std::string& file, size_t amount) const;
+
+private:
+
+   static const size_t shardCount = 64;
+
+   struct Shard {
+      mutable std::mutex mutex;
+      std::unordered_map< std::string, Running > schemes;
+   };
+
+   Shard& shard(const std::string& scheme) {
+      return _shards[std::hash< std::string >()(scheme) % shardCount];
+   }
+
+   std::array< Shard, shardCount > _shards;
+};
+
+#endif
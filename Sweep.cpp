@@ -0,0 +1,109 @@
+#include "Sweep.hpp"
+
+#include "General.hpp"
+
+namespace {
+   std::string trim(const std::string& text) {
+      const auto first = text.find_first_not_of(" \t\r");
+      if (first == std::string::npos) { return ""; }
+      return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+   }
+
+   template < typename T >
+   bool parseValues(const std::string& list, std::vector< T >& values) {
+      // A comma separated list, which replaces the given values
+      std::vector< T > parsed;
+      std::istringstream items(list);
+      std::string item;
+      while (std::getline(items, item, ',')) {
+         std::istringstream value(trim(item));
+         T v;
+         if (!(value >> v) || !value.eof()) { return false; }
+         parsed.push_back(v);
+      }
+      if (parsed.empty()) { return false; }
+      values = parsed;
+      return true;
+   }
+}
+
+bool Sweep::parse(const std::string& file, Spec& spec) {
+   std::ifstream in(file);
+   if (!in) {
+      fprintf(stderr, "Could not read sweep spec %s!\n", file.c_str());
+      return false;
+   }
+   std::string line;
+   unsigned int number = 0;
+   while (std::getline(in, line)) {
+      number++;
+      line = trim(line.substr(0, line.find('#')));
+      if (line.empty()) { continue; }
+      const auto equals = line.find('=');
+      const std::string key = trim(line.substr(0, equals));
+      const std::string values = equals == std::string::npos ?
+                                 "" : line.substr(equals + 1);
+      bool read = false;
+      if (key == "test")        { read = parseValues(values, spec.tests); }
+      else if (key == "layers") { read = parseValues(values, spec.layers); }
+      else if (key == "hidden") { read = parseValues(values, spec.hidden); }
+      else if (key == "alpha")  { read = parseValues(values, spec.alphas); }
+      else if (key == "epochs") { read = parseValues(values, spec.epochs); }
+      else if (key == "seeds")  { read = parseValues(values, spec.seeds); }
+      if (!read) {
+         fprintf(stderr, "%s:%u: could not read \"%s\"!\n",
+                 file.c_str(), number, line.c_str());
+         return false;
+      }
+   }
+   for (const std::string& test : spec.tests) {
+      if (test != "xor" && test != "abc" && test != "gates") {
+         fprintf(stderr, "%s: unknown test %s!\n", file.c_str(), test.c_str());
+         return false;
+      }
+   }
+   for (const uint32_t layers : spec.layers) {
+      if (layers == 0) {
+         fprintf(stderr, "%s: there should be at least 1 layer!\n", file.c_str());
+         return false;
+      }
+   }
+   for (const uint32_t hidden : spec.hidden) {
+      if (hidden == 0) {
+         fprintf(stderr, "%s: there should be at least 1 hidden node!\n", file.c_str());
+         return false;
+      }
+   }
+   for (const uint64_t epochs : spec.epochs) {
+      // The checkpoints are every epochs / 20 epochs
+      if (epochs < 20) {
+         fprintf(stderr, "%s: there should be at least 20 epochs!\n", file.c_str());
+         return false;
+      }
+   }
+   return true;
+}
+
+std::vector< Sweep::Config > Sweep::expand(const Spec& spec) {
+   std::vector< Config > configs;
+   for (const std::string& test : spec.tests) {
+      for (const uint32_t layers : spec.layers) {
+         for (const uint32_t hidden : spec.hidden) {
+            for (const double alpha : spec.alphas) {
+               for (const uint64_t epochs : spec.epochs) {
+                  configs.push_back({test, layers, hidden, alpha, epochs});
+               }
+            }
+         }
+      }
+   }
+   return configs;
+}
+
+std::string Sweep::describe(const Config& config) {
+   return config.test                                    +
+          " l" + std::to_string(config.layers)           +
+          " h" + std::to_string(config.hidden)           +
+          " a" + General::to_string_prec(config.alpha, 2) +
+          " e" + std::to_string(config.epochs);
+}
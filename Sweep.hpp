@@ -0,0 +1,53 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "Includes.hpp"
+
+namespace Sweep {
+   /*
+    * Several configurations swept in one process. A spec file gives
+    * per parameter the values to sweep, one parameter per line:
+    *
+    *    # the topologies of the report, at two learning rates
+    *    test   = xor
+    *    layers = 1, 2
+    *    hidden = 1, 2, 3
+    *    alpha  = 0.25, 0.5
+    *    epochs = 20000
+    *    seeds  = 100, 110, 120
+    *
+    * Every combination of the values is a configuration. Parameters
+    * which are not in the file keep the value of the command line.
+    * hidden is the amount of hidden nodes without the bias node,
+    * as with -n.
+    */
+
+   struct Config {
+      std::string test;
+      uint32_t layers;
+      uint32_t hidden;
+      double alpha;
+      uint64_t epochs;
+   };
+
+   struct Spec {
+      std::vector< std::string > tests;
+      std::vector< uint32_t > layers;
+      std::vector< uint32_t > hidden;
+      std::vector< double > alphas;
+      std::vector< uint64_t > epochs;
+      std::vector< uint16_t > seeds;
+   };
+
+   // Read the spec file over the values already in spec. Returns
+   // false, after printing the problem, if it could not be read.
+   bool parse(const std::string& file, Spec& spec);
+
+   // Every combination of the values of the spec
+   std::vector< Config > expand(const Spec& spec);
+
+   // Like "xor l2 h3 a0.50 e20000"
+   std::string describe(const Config& config);
+}
+
+#endif
@@ -1,5 +1,21 @@
 #include "Tests.hpp"
 
+#include "Quantised.hpp"
+
+namespace {
+   // The cases the ABC test checks, as a, b, c, output
+   const vecvecdo abcTestCases = {
+        {9, 12, 5, 0},
+        {20, 1, 20, 0},
+        {1, 10, 25, 1},
+        {1, -2, 1, 1},
+        {5, -44, 1, 2},
+        {-1, 30, -8, 2},
+        {-5, -20, -4, 2},
+        {3, 8, 4, 2},
+   };
+}
+
 
 // TODO this gives a segfault, as sometimes of is 0x0
 template <typename T>
@@ -34,6 +50,7 @@ void Tests::PrintResults(const vecvecdo& inputs,
       assert(inputSize == outputSize && 
              "No equal size of input and output vector!");
    }
+   Trace::Span span("write results", "io");
    FILE *of = nullptr;
    assert(((toFile && !filename.empty()) || !toFile) &&
           "No filename given but expected!");
@@ -53,7 +70,9 @@ void Tests::PrintResults(const vecvecdo& inputs,
    if (toFile) { fclose(of); }
 }
 
-void Tests::XOR(vecdo& inputs, double& output) {
+void Tests::XOR(vecdo& inputs,
+                double& output,
+                const std::function< int() >& draw/* = rand*/) {
    /*
     * Create input and expected output for the XOR
     * problem. Two numbers are generated, either 0 or 1,
@@ -62,8 +81,8 @@ void Tests::XOR(vecdo& inputs, double& output) {
     * If the numbers are 0, they are changed to -1 so the
     * network can use these numbers.
     */
-   int a = rand() % 2 == 0;
-   int b = rand() % 2 == 0;
+   int a = draw() % 2 == 0;
+   int b = draw() % 2 == 0;
    output = (a + b) % 2;
    if (a == 0) { a = -1; }
    if (b == 0) { b = -1; }
@@ -77,7 +96,9 @@ double Tests::ABCFormula(const int16_t a,
    return a * x * x + b * x + c;
 }
 
-void Tests::ABC(vecdo& inputs, double& output) {
+void Tests::ABC(vecdo& inputs,
+                double& output,
+                const std::function< int() >& draw/* = rand*/) {
    /*
     * Create input and expected output for the ABC-formula.
     * This is a formula to calculate how many times a line,
@@ -92,10 +113,10 @@ void Tests::ABC(vecdo& inputs, double& output) {
     */
    const int16_t min = -100;
    const uint16_t max = 100;
-   auto a = static_cast<int16_t>(min + (rand() % max - min + 1));
-   while (a == 0) { a = static_cast<int16_t>(min + (rand() % max - min + 1)); }
-   const auto b = static_cast<int16_t>(min + (rand() % max - min + 1));
-   const auto c = static_cast<int16_t>(min + (rand() % max - min + 1));
+   auto a = static_cast<int16_t>(min + (draw() % max - min + 1));
+   while (a == 0) { a = static_cast<int16_t>(min + (draw() % max - min + 1)); }
+   const auto b = static_cast<int16_t>(min + (draw() % max - min + 1));
+   const auto c = static_cast<int16_t>(min + (draw() % max - min + 1));
    
    inputs = {static_cast<double>(a),
              static_cast<double>(b),
@@ -114,6 +135,24 @@ void Tests::ABC(vecdo& inputs, double& output) {
    }
 }
 
+void Tests::Gates(vecdo& inputs,
+                  vecdo& outputs,
+                  const std::function< int() >& draw/* = rand*/) {
+   /*
+    * Create input and expected outputs for three related
+    * targets at once: the XOR, AND and OR of two numbers,
+    * either 0 or 1. As in XOR(), the inputs are -1 instead
+    * of 0. The bias node comes last, where the network has
+    * it.
+    */
+   const int a = draw() % 2 == 0;
+   const int b = draw() % 2 == 0;
+   outputs.assign({static_cast<double>(a != b),
+                   static_cast<double>(a && b),
+                   static_cast<double>(a || b)});
+   inputs = {a ? 1.0 : -1.0, b ? 1.0 : -1.0, -1.0};
+}
+
 void Tests::runSmallTest(vecdo& inputs, 
                          double& output, 
                          const std::string& test) {
@@ -122,14 +161,264 @@ void Tests::runSmallTest(vecdo& inputs,
    else { throw("Given test does not exist!\n"); }
 }
 
+void Tests::runSmallTest(vecdo& inputs,
+                         vecdo& outputs,
+                         const std::string& test) {
+   if (test == "gates") { return Gates(inputs, outputs); }
+   double output;
+   runSmallTest(inputs, output, test);
+   outputs.assign(1, output);
+}
+
+void Tests::heldOut(const std::string& test,
+                    const size_t amount,
+                    const uint32_t seed,
+                    vecvecdo& inputs,
+                    vecdo& expected,
+                    vecdo& outcomes) {
+   /*
+    * The cases come from the same generators as the training
+    * cases, but with a random engine of their own, so the
+    * training draws of rand() stay as they are and every
+    * network is validated on the same cases.
+    * They are then put in the form testGrid() gives: xor has
+    * the bias last, abc sigmoids its inputs and outcome.
+    */
+   std::mt19937 random(seed);
+   const std::function< int() > draw = [&random]() {
+      return static_cast<int>(random() >> 1);
+   };
+   inputs.clear();
+   expected.clear();
+   outcomes.clear();
+   inputs.reserve(amount);
+   expected.reserve(amount);
+   outcomes.reserve(amount);
+   vecdo in;
+   double outcome;
+   for (size_t c = 0; c < amount; c++) {
+      if (test == "xor") {
+         XOR(in, outcome, draw);
+         inputs.push_back({in[1], in[2], -1.0});
+         expected.push_back(outcome);
+      } else if (test == "abc") {
+         ABC(in, outcome, draw);
+         inputs.push_back({General::sigmoid(in[0]),
+                           General::sigmoid(in[1]),
+                           General::sigmoid(in[2]),
+                           -1.0});
+         expected.push_back(General::sigmoid(outcome));
+      } else { throw("Given test does not exist!\n"); }
+      outcomes.push_back(outcome);
+   }
+}
+
 double Tests::runTest(const TestParameters tp, 
                       const std::string& test,
                       const bool print/* = true*/) {
    if(test == "xor") { return XORTest(tp, print); }
    if(test == "abc") { return ABCTest(tp, print); }
+   if(test == "gates") { return GatesTest(tp, print); }
    else { throw("Given test does not exist!\n"); }
 }
 
+void Tests::printError(const TestParameters& tp,
+                       const std::string& test,
+                       const double error) {
+   /*
+    * Writes the same as XORTest or ABCTest with seedtest set,
+    * for results which come from the cache.
+    */
+   std::string filename = tp.fileName;
+   filename.insert(filename.find("." + test + "output"), tp.addition);
+   PrintResults({}, {}, tp.toFile, filename, tp.writeMode);
+   PrintResults({{static_cast<double>(tp.seed)}}, {error}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "error: ");
+}
+
+void Tests::reportPruning(const TestParameters tp,
+                          const std::string& test,
+                          const double errorBefore,
+                          const double errorAfter) {
+   /*
+    * Report what pruning the network did: the fraction of the
+    * weights which is left, the fraction of the multiplications
+    * the sparse kernels save, and the change in error.
+    * It is written next to the results of the test, to a file
+    * with "pruned" added to its name.
+    */
+   std::string filename = tp.fileName;
+   const auto extension = filename.find("." + test + "output");
+   if (extension != std::string::npos) { filename.insert(extension, "pruned"); }
+   
+   const vecvecdo seed = {{static_cast<double>(tp.seed)}};
+   PrintResults(seed, {tp.network.density()}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "density: ");
+   PrintResults(seed, {tp.network.flopsSaved()}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "flopsSaved: ");
+   PrintResults(seed, {errorAfter - errorBefore}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "errorChange: ");
+}
+
+void Tests::testGrid(const std::string& test,
+                     vecvecdo& inputs,
+                     vecdo& expected) {
+   /*
+    * The inputs of the network and the expected outputs for
+    * every case XORTest or ABCTest checks.
+    */
+   if (test == "xor") {
+      for (double i = -1; i <= 1; i += 2) {
+         for (double j = -1; j <= 1; j += 2) {
+            inputs.push_back({i, j, -1.0});
+            expected.push_back(i != j);
+         }
+      }
+   } else if (test == "abc") {
+      for (const vecdo& c : abcTestCases) {
+         inputs.push_back({General::sigmoid(c[0]),
+                           General::sigmoid(c[1]),
+                           General::sigmoid(c[2]),
+                           -1.0});
+         expected.push_back(General::sigmoid(c[3]));
+      }
+   } else { throw("Given test does not exist!\n"); }
+}
+
+void Tests::reportQuantisation(TestParameters tp,
+                               const std::string& test) {
+   /*
+    * Compare the int8 version of the trained network with the
+    * network itself on the cases of the test: the largest
+    * difference between their outputs, the change in error, how
+    * many times faster the integer forward propagation is, and
+    * the fraction of the memory its weights take up.
+    * It is written to a file with "quantised" added to its name.
+    */
+   const QuantisedNetwork q(tp.network);
+   Network& n = tp.network;
+   vecvecdo inputs;
+   vecdo expected;
+   testGrid(test, inputs, expected);
+
+   double deviation = 0.0, error = 0.0, quantisedError = 0.0;
+   for (size_t c = 0; c < inputs.size(); c++) {
+      n.inputs(inputs[c]);
+      n.forward();
+      const double output = General::sigmoid(n.calculatedOutput());
+      const double quantised = General::sigmoid(q.forward(inputs[c]));
+      deviation = std::max(deviation, std::fabs(output - quantised));
+      const double difference = expected[c] - output;
+      const double quantisedDifference = expected[c] - quantised;
+      error += difference > 0 ? difference : 1.0 - difference;
+      quantisedError += quantisedDifference > 0 ?
+                        quantisedDifference : 1.0 - quantisedDifference;
+   }
+
+   // Time enough passes over the cases to get a stable measurement
+   const uint32_t repeats = 2000;
+   volatile double sink = 0.0;
+   auto start = std::chrono::steady_clock::now();
+   for (uint32_t r = 0; r < repeats; r++) {
+      for (const vecdo& in : inputs) {
+         n.inputs(in);
+         n.forward();
+         sink = n.calculatedOutput();
+      }
+   }
+   const double doubleTime = std::chrono::duration< double >(
+                                std::chrono::steady_clock::now() - start).count();
+   start = std::chrono::steady_clock::now();
+   for (uint32_t r = 0; r < repeats; r++) {
+      for (const vecdo& in : inputs) { sink = q.forward(in); }
+   }
+   const double quantisedTime = std::chrono::duration< double >(
+                                   std::chrono::steady_clock::now() - start).count();
+   (void)sink;
+
+   size_t weights = n.weightsFromInputs().size() * n.weightsFromInputs(0).size() +
+                    n.weightsToOutput().size() * n.weightsToOutput(0).size();
+   for (const vecvecdo& layer : n.weightsHiddenLayers()) {
+      if (!layer.empty()) { weights += layer.size() * layer[0].size(); }
+   }
+
+   std::string filename = tp.fileName;
+   const auto extension = filename.find("." + test + "output");
+   if (extension != std::string::npos) { filename.insert(extension, "quantised"); }
+
+   const vecvecdo seed = {{static_cast<double>(tp.seed)}};
+   PrintResults(seed, {deviation}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "deviation: ");
+   PrintResults(seed, {quantisedError - error}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "errorChange: ");
+   PrintResults(seed, {quantisedTime > 0.0 ? doubleTime / quantisedTime : 0.0},
+                tp.toFile, filename, tp.writeMode, "seed: ", "speedup: ");
+   PrintResults(seed, {static_cast<double>(q.bytes()) /
+                       (weights * sizeof(double))},
+                tp.toFile, filename, tp.writeMode, "seed: ", "memory: ");
+}
+
+void Tests::reportValidation(const TestParameters& tp,
+                             const std::string& test,
+                             const Validation::Metrics& metrics,
+                             const double trainingSeconds) {
+   /*
+    * Report how the network does on the held-out cases: the
+    * mean squared and absolute error, the fraction of the cases
+    * of which the nearest outcome is the right one, overall and
+    * per outcome, and the time the validation took as a
+    * fraction of the training.
+    * It is written to a file with "validation" added to its name.
+    */
+   std::string filename = tp.fileName;
+   const auto extension = filename.find("." + test + "output");
+   if (extension != std::string::npos) { filename.insert(extension, "validation"); }
+
+   const vecvecdo seed = {{static_cast<double>(tp.seed)}};
+   PrintResults(seed, {static_cast<double>(metrics.cases)}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "cases: ");
+   PrintResults(seed, {metrics.mse}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "mse: ");
+   PrintResults(seed, {metrics.mae}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "mae: ");
+   PrintResults(seed, {metrics.accuracy}, tp.toFile, filename,
+                tp.writeMode, "seed: ", "accuracy: ");
+   for (const Validation::Class& c : metrics.classes) {
+      PrintResults(seed, {c.cases > 0 ? static_cast<double>(c.correct) / c.cases : 0.0},
+                   tp.toFile, filename, tp.writeMode, "seed: ",
+                   "accuracy" + std::to_string(static_cast<int>(c.outcome)) + ": ");
+   }
+   PrintResults(seed, {trainingSeconds > 0.0 ? metrics.seconds / trainingSeconds : 0.0},
+                tp.toFile, filename, tp.writeMode, "seed: ", "cost: ");
+}
+
+double Tests::modelTest(const Model::Mapped& model,
+                        const std::string& test) {
+   /*
+    * Run the cases of the test on a saved model, and print its
+    * outputs and error to the terminal.
+    */
+   vecvecdo inputs;
+   vecdo expected;
+   testGrid(test, inputs, expected);
+   
+   vecvecdo shown;
+   vecdo outputs;
+   double error = 0.0;
+   for (size_t c = 0; c < inputs.size(); c++) {
+      const double output = General::sigmoid(model.forward(inputs[c]));
+      const double outputDifference = expected[c] - output;
+      error += outputDifference > 0 ? outputDifference : 1.0 - outputDifference;
+      shown.emplace_back(inputs[c].begin(), inputs[c].end() - 1);
+      outputs.push_back(output);
+   }
+   PrintResults(shown, outputs);
+   Print(nullptr, "error: ", false);
+   Print(nullptr, error, false);
+   Print(nullptr, "\n", false);
+   return error;
+}
+
 double Tests::XORTest(const TestParameters tp, const bool print) {
    /*
     * Given the trained network, calculate the error by
@@ -209,22 +498,10 @@ double Tests::ABCTest(const TestParameters tp, const bool print) {
    
    Network n = tp.network;
    
-   const vecvecdo testcases = {
-        // a, b, c, output
-        {9, 12, 5, 0},
-        {20, 1, 20, 0},
-        {1, 10, 25, 1},
-        {1, -2, 1, 1},
-        {5, -44, 1, 2},
-        {-1, 30, -8, 2},
-        {-5, -20, -4, 2},
-        {3, 8, 4, 2},
-   };
-   
    double outputDifference;
    double error = 0.0;
    
-   for (vecdo test : testcases) {
+   for (vecdo test : abcTestCases) {
       n.inputs({General::sigmoid(test[0]),
                 General::sigmoid(test[1]), 
                 General::sigmoid(test[2]),
@@ -276,3 +553,62 @@ double Tests::ABCTest(const TestParameters tp, const bool print) {
    
    return error;
 }
+
+double Tests::GatesTest(const TestParameters tp, const bool print) {
+   /*
+    * Like XORTest, but every case checks all three outputs
+    * of the network, the XOR, AND and OR of the inputs, which
+    * come out of a single forward propagation. The error is
+    * summed over the outputs.
+    */
+   vecvecdo inputs;
+   vecdo outputs;
+   
+   Network n = tp.network;
+   
+   double outputDifference;
+   double error = 0.0;
+   for (double i = -1; i <= 1; i += 2) {
+      for (double j = -1; j <= 1; j += 2) {
+         n.inputs({i, j, -1.0});
+         n.expectedOutputs({static_cast<double>(i != j),
+                            static_cast<double>(i > 0 && j > 0),
+                            static_cast<double>(i > 0 || j > 0)});
+         n.forward();
+         for (uint32_t o = 0; o < n.amOutputNodes(); o++) {
+            const double output = General::sigmoid(n.calculatedOutputs()[o]);
+            outputDifference = n.expectedOutputs()[o] - output;
+            error += outputDifference > 0 ? outputDifference : 1.0 - outputDifference;
+            if (!tp.seedtest) {
+               inputs.push_back({i, j, static_cast<double>(o)});
+               outputs.push_back(output);
+            }
+         }
+      }
+   }
+   
+   if(print) {
+      std::string filename = tp.fileName;
+      if (tp.fileName.empty()) {
+         filename = "i" + std::to_string(n.amInputNodes()) +
+                    "l" + std::to_string(n.amHiddenLayers()) +
+                    "h" + std::to_string(n.amHiddenNodes()) +
+                    "a" + std::to_string(n.alpha()) +
+                    ".gatesoutput";
+      }
+      filename.insert(filename.find(".gatesoutput"), tp.addition);
+      PrintResults(inputs, outputs, tp.toFile, filename, tp.writeMode);
+      inputs.clear();
+      outputs.clear();
+      outputs.push_back(error);
+      if (tp.seedtest) {
+         inputs.push_back({static_cast<double>(tp.seed)});
+         PrintResults(inputs, outputs, tp.toFile, filename, 
+                      tp.writeMode, "seed: ", "error: ");
+      } else {
+         PrintResults(inputs, outputs, tp.toFile, filename, 
+                      tp.writeMode, "", "error: ", false);
+      }
+   }
+   return error;
+}
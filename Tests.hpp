@@ -7,8 +7,10 @@
 
 #include "Includes.hpp"
 
-#include "General.cpp"
+#include "General.hpp"
+#include "Model.hpp"
 #include "Network.hpp"
+#include "Validation.hpp"
 
 class Tests {
    public:
@@ -52,11 +54,49 @@ class Tests {
       void runSmallTest(vecdo& inputs, 
                                double& output, 
                                const std::string& test);
+      // The same with the expected value of every output node, for
+      // tests with more than one target as well
+      void runSmallTest(vecdo& inputs,
+                        vecdo& outputs,
+                        const std::string& test);
+      
+      // Cases drawn at random like the training cases, from a
+      // generator of their own seeded with seed, and given in the form
+      // runTest() uses: the inputs, the expected outputs and the
+      // outcomes these stand for (the 0 or 1 of xor, or the amount of
+      // roots of abc).
+      void heldOut(const std::string& test,
+                   size_t amount,
+                   uint32_t seed,
+                   vecvecdo& inputs,
+                   vecdo& expected,
+                   vecdo& outcomes);
       
       double runTest(TestParameters tp, 
                      const std::string& test,
                      bool print = true);
       
+      // Print an error which is already known, as runTest() would
+      void printError(const TestParameters& tp,
+                      const std::string& test,
+                      double error);
+      
+      void reportPruning(TestParameters tp,
+                         const std::string& test,
+                         double errorBefore,
+                         double errorAfter);
+      
+      void reportQuantisation(TestParameters tp,
+                              const std::string& test);
+      
+      void reportValidation(const TestParameters& tp,
+                            const std::string& test,
+                            const Validation::Metrics& metrics,
+                            double trainingSeconds);
+      
+      double modelTest(const Model::Mapped& model,
+                       const std::string& test);
+      
    private:
       template <typename T>
       void Print(FILE* of,
@@ -72,8 +112,20 @@ class Tests {
                         const std::string& secondString = "Out: ",
                         bool equalSize = true);
 
-      void XOR(vecdo& inputs, double& output);
-      void ABC(vecdo& inputs, double& output);
+      void testGrid(const std::string& test,
+                    vecvecdo& inputs,
+                    vecdo& expected);
+
+      // The random numbers are taken from draw, rand() by default
+      void XOR(vecdo& inputs,
+               double& output,
+               const std::function< int() >& draw = rand);
+      void ABC(vecdo& inputs,
+               double& output,
+               const std::function< int() >& draw = rand);
+      void Gates(vecdo& inputs,
+                 vecdo& outputs,
+                 const std::function< int() >& draw = rand);
       double ABCFormula(int16_t a,
                         int16_t b,
                         int16_t c,
@@ -81,6 +133,7 @@ class Tests {
 
       double XORTest(TestParameters tp, bool print);
       double ABCTest(TestParameters tp, bool print);
+      double GatesTest(TestParameters tp, bool print);
 };
 
 #endif
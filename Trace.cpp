@@ -0,0 +1,114 @@
+#include "Trace.hpp"
+
+namespace {
+   // Global state of the tracer. The buffers are only created and
+   // collected under the mutex, recording itself never takes it.
+   std::atomic< bool > traceEnabled(false);
+   std::string traceFile;
+   size_t traceCapacity = 0;
+   std::chrono::steady_clock::time_point traceStart;
+   std::mutex buffersMutex;
+   std::vector< std::unique_ptr< Trace::Buffer > > buffers;
+
+   thread_local Trace::Buffer *localBuffer = nullptr;
+
+   Trace::Buffer *threadBuffer() {
+      /*
+       * Returns the buffer of the calling thread, creating and
+       * registering it on the first call of that thread.
+       */
+      if (localBuffer == nullptr) {
+         std::lock_guard< std::mutex > lock(buffersMutex);
+         buffers.emplace_back(new Trace::Buffer(
+                    traceCapacity, static_cast<uint32_t>(buffers.size())));
+         localBuffer = buffers.back().get();
+      }
+      return localBuffer;
+   }
+}
+
+void Trace::enable(const std::string& fileName, const size_t capacity) {
+   traceFile = fileName;
+   traceCapacity = capacity > 0 ? capacity : 1;
+   traceStart = std::chrono::steady_clock::now();
+   traceEnabled.store(true, std::memory_order_release);
+}
+
+bool Trace::enabled() {
+   return traceEnabled.load(std::memory_order_relaxed);
+}
+
+uint64_t Trace::now() {
+   return static_cast<uint64_t>(
+             std::chrono::duration_cast< std::chrono::microseconds >(
+                std::chrono::steady_clock::now() - traceStart).count());
+}
+
+void Trace::record(const char *name,
+                   const char *category,
+                   const uint64_t start,
+                   const int64_t seed/* = -1*/,
+                   const int64_t scheme/* = -1*/) {
+   if (!enabled()) { return; }
+   const uint64_t end = now();
+   threadBuffer()->push({name, category, start, end - start, seed, scheme});
+}
+
+bool Trace::write() {
+   /*
+    * Writes every recorded event to the trace file in the
+    * Chrome trace-event format, which can be opened in
+    * chrome://tracing or Perfetto.
+    * Each recording thread shows up as its own row.
+    * Recording is disabled first, so the buffers are not
+    * modified while they are written.
+    */
+   if (!enabled()) { return false; }
+   traceEnabled.store(false, std::memory_order_release);
+
+   FILE *of = fopen(traceFile.c_str(), "w");
+   if (of == nullptr) {
+      fprintf(stderr, "Could not write the trace to %s!\n", traceFile.c_str());
+      return false;
+   }
+
+   std::lock_guard< std::mutex > lock(buffersMutex);
+   const int pid = static_cast<int>(getpid());
+   fprintf(of, "{\"traceEvents\":[\n");
+   bool first = true;
+   for (const auto& buffer : buffers) {
+      fprintf(of, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                  "\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}",
+              first ? "" : ",\n", pid, buffer->threadId(), buffer->threadId());
+      first = false;
+
+      const uint64_t recorded = buffer->recorded();
+      const uint64_t begin = recorded > buffer->capacity() ?
+                             recorded - buffer->capacity() : 0;
+      for (uint64_t i = begin; i < recorded; i++) {
+         const Event& e = buffer->event(i);
+         fprintf(of, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                     "\"pid\":%d,\"tid\":%u,\"ts\":%llu,\"dur\":%llu,\"args\":{",
+                 e.name, e.category, pid, buffer->threadId(),
+                 static_cast<unsigned long long>(e.start),
+                 static_cast<unsigned long long>(e.duration));
+         if (e.seed >= 0) {
+            fprintf(of, "\"seed\":%lld", static_cast<long long>(e.seed));
+         }
+         if (e.scheme >= 0) {
+            fprintf(of, "%s\"scheme\":%lld", e.seed >= 0 ? "," : "",
+                    static_cast<long long>(e.scheme));
+         }
+         fprintf(of, "}}");
+      }
+      if (recorded > buffer->capacity()) {
+         fprintf(stderr, "Trace buffer of worker %u overflowed, "
+                         "%llu oldest events were dropped.\n",
+                 buffer->threadId(),
+                 static_cast<unsigned long long>(begin));
+      }
+   }
+   fprintf(of, "\n],\"displayTimeUnit\":\"ms\"}\n");
+   fclose(of);
+   return true;
+}
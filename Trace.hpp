@@ -0,0 +1,103 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include "Includes.hpp"
+
+namespace Trace {
+
+   struct Event {
+      /*
+       * A single finished span, written out as a complete ("X") event
+       * of the Chrome trace-event format.
+       * name and category have to point to string literals, so that
+       * recording an event never allocates.
+       * seed and scheme are left at -1 when they are not relevant.
+       */
+      const char *name;
+      const char *category;
+      uint64_t start;    // microseconds since Trace::enable()
+      uint64_t duration; // microseconds
+      int64_t seed;
+      int64_t scheme;
+   };
+
+   class Buffer {
+      /*
+       * Ring buffer holding the events of a single thread.
+       * Only the owning thread ever writes to it, so recording
+       * is lock free. When the buffer is full the oldest events
+       * are overwritten.
+       */
+   public:
+      Buffer(const size_t capacity, const uint32_t threadId)
+         : _events(capacity), _recorded(0), _threadId(threadId) {}
+
+      void push(const Event& e) {
+         const uint64_t n = _recorded.load(std::memory_order_relaxed);
+         _events[n % _events.size()] = e;
+         _recorded.store(n + 1, std::memory_order_release);
+      }
+
+      uint64_t recorded() const
+         { return _recorded.load(std::memory_order_acquire); }
+      size_t capacity() const { return _events.size(); }
+      const Event& event(const uint64_t i) const
+         { return _events[i % _events.size()]; }
+      uint32_t threadId() const { return _threadId; }
+
+   private:
+      std::vector< Event > _events;
+      std::atomic< uint64_t > _recorded;
+      uint32_t _threadId;
+   };
+
+   // Turn on recording. The trace is written to fileName by write().
+   void enable(const std::string& fileName, size_t capacity = 8192);
+
+   bool enabled();
+
+   // Microseconds since enable() was called.
+   uint64_t now();
+
+   // Record a span which started at start (as given by now()) and
+   // ends at this moment.
+   void record(const char *name,
+               const char *category,
+               uint64_t start,
+               int64_t seed = -1,
+               int64_t scheme = -1);
+
+   // Stop recording and write all buffers as Chrome trace-event JSON.
+   bool write();
+
+   class Span {
+      /*
+       * Records the lifetime of the object as a span.
+       * Does nothing when tracing is not enabled.
+       */
+   public:
+      Span(const char *name,
+           const char *category,
+           const int64_t seed = -1,
+           const int64_t scheme = -1)
+         : _name(name), _category(category), _seed(seed), _scheme(scheme),
+           _active(enabled()), _start(_active ? now() : 0) {}
+
+      ~Span() {
+         if (_active) { record(_name, _category, _start, _seed, _scheme); }
+      }
+
+      Span(const Span&) = delete;
+      Span& operator=(const Span&) = delete;
+
+   private:
+      const char *_name;
+      const char *_category;
+      int64_t _seed;
+      int64_t _scheme;
+      bool _active;
+      uint64_t _start;
+   };
+}
+
+#endif
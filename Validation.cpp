@@ -0,0 +1,94 @@
+#include "Validation.hpp"
+
+#include "Tests.hpp"
+
+Validation::Validation(const std::string& test,
+                       const size_t amount,
+                       const uint32_t seed) : _test(test) {
+   Tests tests;
+   vecdo outcomes;
+   tests.heldOut(test, amount, seed, _inputs, _expected, outcomes);
+
+   // The outcomes map to their expected outputs in the same order
+   std::map< double, double > classes;
+   for (size_t c = 0; c < outcomes.size(); c++) {
+      classes[outcomes[c]] = _expected[c];
+   }
+   for (const auto& c : classes) {
+      _outcomes.push_back(c.first);
+      _outputs.push_back(c.second);
+   }
+   _classes.reserve(outcomes.size());
+   for (const double outcome : outcomes) {
+      _classes.push_back(static_cast<uint32_t>(
+         std::lower_bound(_outcomes.begin(), _outcomes.end(), outcome) -
+         _outcomes.begin()));
+   }
+}
+
+Validation::Metrics Validation::evaluate(const Network& n,
+                                         const unsigned int threads) const {
+   /*
+    * Every thread propagates a contiguous batch of the cases and
+    * writes the outputs to its part of one buffer. The metrics
+    * are gathered from that buffer afterwards, in order.
+    */
+   const auto start = std::chrono::steady_clock::now();
+   const size_t cases = _inputs.size();
+   vecdo outputs(cases);
+   const size_t amount = std::max< size_t >(1, std::min< size_t >(threads, cases));
+   const size_t batch = (cases + amount - 1) / std::max< size_t >(1, amount);
+
+   const auto work = [&](const size_t t) {
+      const size_t begin = t * batch;
+      const size_t end = std::min(cases, begin + batch);
+      if (begin < end) { n.forward(_inputs, begin, end, outputs.data() + begin); }
+   };
+   std::vector< std::future< void > > futures;
+   for (size_t t = 1; t < amount; t++) {
+      futures.push_back(std::async(std::launch::async, work, t));
+   }
+   work(0);
+   for (auto& f : futures) { f.get(); }
+
+   Metrics m;
+   m.cases = cases;
+   for (const double outcome : _outcomes) {
+      Class c;
+      c.outcome = outcome;
+      m.classes.push_back(c);
+   }
+   uint64_t correct = 0;
+   for (size_t c = 0; c < cases; c++) {
+      const double output = General::sigmoid(outputs[c]);
+      const double difference = _expected[c] - output;
+      m.mse += difference * difference;
+      m.mae += std::fabs(difference);
+
+      Class& cls = m.classes[_classes[c]];
+      cls.cases++;
+      // A NaN output is never right, nor compared
+      if (!std::isfinite(output)) { continue; }
+      size_t nearest = 0;
+      for (size_t o = 1; o < _outputs.size(); o++) {
+         if (std::fabs(_outputs[o] - output) < std::fabs(_outputs[nearest] - output)) {
+            nearest = o;
+         }
+      }
+      if (nearest == _classes[c]) {
+         cls.correct++;
+         correct++;
+      }
+   }
+   if (cases > 0) {
+      m.mse /= cases;
+      m.mae /= cases;
+      m.accuracy = static_cast<double>(correct) / cases;
+   }
+
+   m.seconds = std::chrono::duration< double >(
+                  std::chrono::steady_clock::now() - start).count();
+   _evaluated.fetch_add(1, std::memory_order_relaxed);
+   _micros.fetch_add(static_cast<uint64_t>(m.seconds * 1e6), std::memory_order_relaxed);
+   return m;
+}
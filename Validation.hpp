@@ -0,0 +1,73 @@
+#ifndef VALIDATION_HPP
+#define VALIDATION_HPP
+
+#include "Includes.hpp"
+
+#include "Network.hpp"
+
+class Validation {
+   /*
+    * A held-out set of generated cases of a test, far more than the
+    * few cases XORTest and ABCTest check, so networks can be ranked
+    * without the noise of those.
+    * The set is made once and only read afterwards, so any number
+    * of threads can validate their networks on it at the same time.
+    * A validation propagates the cases through the network in
+    * batches, one per thread, without copying the network, and
+    * gathers the metrics in a single pass in the order of the
+    * cases, so they do not depend on the amount of threads.
+    */
+public:
+
+   // The cases of one outcome, and how many of them were right
+   struct Class {
+      double outcome;
+      uint64_t cases = 0;
+      uint64_t correct = 0;
+   };
+
+   struct Metrics {
+      uint64_t cases = 0;
+      double mse = 0.0;
+      double mae = 0.0; // mean absolute error
+      double accuracy = 0.0;
+      std::vector< Class > classes;
+      double seconds = 0.0;
+   };
+
+   // amount cases of test, drawn from a generator seeded with seed
+   Validation(const std::string& test, size_t amount, uint32_t seed);
+
+   Validation(const Validation&) = delete;
+   Validation& operator=(const Validation&) = delete;
+
+   const std::string& test() const { return _test; }
+   size_t size() const { return _inputs.size(); }
+
+   // The metrics of the network on the set, split over threads.
+   // A case is right if its expected output is the one nearest to
+   // the output of the network.
+   Metrics evaluate(const Network& n, unsigned int threads) const;
+
+   uint64_t evaluated() const { return _evaluated.load(std::memory_order_relaxed); }
+   // Seconds all evaluations took together
+   double seconds() const {
+      return _micros.load(std::memory_order_relaxed) / 1e6;
+   }
+
+private:
+
+   std::string _test;
+   vecvecdo _inputs;
+   vecdo _expected;
+   // The class of every case, an index into _outcomes
+   std::vector< uint32_t > _classes;
+   // The outcomes which occur and their expected outputs, ascending
+   vecdo _outcomes;
+   vecdo _outputs;
+
+   mutable std::atomic< uint64_t > _evaluated{0};
+   mutable std::atomic< uint64_t > _micros{0};
+};
+
+#endif